@@ -1,7 +1,201 @@
 #ifndef ARENA_C
 #define ARENA_C
 
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ARENA_HAS_MMAP 1
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Branch hints and attributes for the allocation fast paths. Fast paths are static inline, the
+ * rarely taken slow paths (new page, large block, commit) are kept out of line.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define ARENA_LIKELY(x) __builtin_expect(!!(x), 1)
+#define ARENA_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define ARENA_COLD __attribute__((cold, noinline))
+#else
+#define ARENA_LIKELY(x) (x)
+#define ARENA_UNLIKELY(x) (x)
+#define ARENA_COLD
+#endif
+
+/**
+ * Debug and release builds. Defining ARENA_DEBUG turns on argument checks on the allocation fast
+ * paths, guard bytes after every allocation, which are verified on reset, rewind and free, and
+ * poisoning of fresh and released memory. Release builds leave the checks out of the fast paths,
+ * passing NULL to an allocation function is undefined behavior there.
+ */
+#ifdef ARENA_DEBUG
+#include <stdio.h>
+#define ARENA_CHECK(condition, result) do { if (!(condition)) return result; } while (0)
+#define ARENA_ALLOC_HEADER_SIZE 16  // Records the previous allocation and the size, see ArenaDebugHeader
+#define ARENA_GUARD_SIZE 16         // Guard bytes after every allocation
+#define ARENA_GUARD_BYTE 0xFD       // Value of the guard bytes
+#define ARENA_FRESH_BYTE 0xCD       // Fills memory handed out by an allocation
+#define ARENA_POISON_BYTE 0xDD      // Fills memory released by reset and rewind
+#else
+#define ARENA_CHECK(condition, result) do { } while (0)
+#define ARENA_ALLOC_HEADER_SIZE 0
+#endif
+
+/**
+ * Memory checker integration. Under AddressSanitizer, or under Valgrind when ARENA_VALGRIND is
+ * defined, the arena memory that is not handed out is poisoned: a fresh arena, memory released by
+ * reset and rewind, alignment padding and a red zone of ARENA_REDZONE_SIZE bytes after every
+ * allocation. Each allocation is unpoisoned, so use after reset and overflows into the next
+ * allocation are reported. Other builds compile the calls away.
+ */
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define ARENA_ASAN 1
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) && !defined(ARENA_ASAN)
+#define ARENA_ASAN 1
+#endif
+
+#if defined(ARENA_ASAN)
+#include <sanitizer/asan_interface.h>
+#define ARENA_SANITIZE 1
+#define ARENA_POISON(ptr, size) ASAN_POISON_MEMORY_REGION((ptr), (size))
+#define ARENA_UNPOISON(ptr, size) ASAN_UNPOISON_MEMORY_REGION((ptr), (size))
+#elif defined(ARENA_VALGRIND)
+#include <valgrind/memcheck.h>
+#define ARENA_SANITIZE 1
+#define ARENA_POISON(ptr, size) ((void)VALGRIND_MAKE_MEM_NOACCESS((ptr), (size)))
+#define ARENA_UNPOISON(ptr, size) ((void)VALGRIND_MAKE_MEM_UNDEFINED((ptr), (size)))
+#else
+#define ARENA_POISON(ptr, size) ((void)(ptr), (void)(size))
+#define ARENA_UNPOISON(ptr, size) ((void)(ptr), (void)(size))
+#endif
+
+#if defined(ARENA_SANITIZE) && !defined(ARENA_REDZONE_SIZE)
+#define ARENA_REDZONE_SIZE 16
+#endif
+
+/**
+ * Bytes after every allocation, the guard bytes of debug builds double as the red zone.
+ */
+#if defined(ARENA_DEBUG)
+#elif defined(ARENA_SANITIZE)
+#define ARENA_GUARD_SIZE ARENA_REDZONE_SIZE
+#else
+#define ARENA_GUARD_SIZE 0
+#endif
+
+/**
+ * Bytes an allocation takes in addition to its size, not counting alignment padding.
+ */
+#define ARENA_ALLOC_OVERHEAD (ARENA_ALLOC_HEADER_SIZE + ARENA_GUARD_SIZE)
+
+/**
+ * Default alignment for aligned allocations, suitable for any scalar type.
+ */
+#define ARENA_DEFAULT_ALIGNMENT alignof(max_align_t)
+
+/**
+ * Largest alignment supported by the aligned allocation functions.
+ */
+#define ARENA_MAX_ALIGNMENT 4096
+
+/**
+ * Backing allocator for the memory of an arena: the block of an Arena, the pages and large
+ * blocks of a GrowableArena. alloc returns memory aligned like malloc or NULL, free receives the
+ * size that was passed to alloc. realloc is optional, it resizes a block like realloc and lets
+ * large blocks of a growable arena grow without copying.
+ */
+typedef struct arena_allocator_t {
+    void *(*alloc)(void *context, size_t size);
+    void (*free)(void *context, void *ptr, size_t size);
+    void *context;
+    void *(*realloc)(void *context, void *ptr, size_t old_size, size_t new_size);
+} ArenaAllocator;
+
+/**
+ * Allocate memory from a backing allocator.
+ * @param allocator The allocator or NULL for malloc
+ * @param size No. of bytes to allocate
+ * @return Pointer to the memory block or NULL if allocation failed
+ */
+static inline void *ArenaAllocator_alloc(const ArenaAllocator *allocator, const size_t size) {
+    if (allocator == NULL) return malloc(size);
+    return allocator->alloc(allocator->context, size);
+}
+
+/**
+ * Release memory to a backing allocator.
+ * @param allocator The allocator or NULL for free
+ * @param ptr The memory block
+ * @param size The size of the memory block as passed to ArenaAllocator_alloc
+ */
+static inline void ArenaAllocator_free(const ArenaAllocator *allocator, void *ptr, const size_t size) {
+    if (allocator == NULL) free(ptr);
+    else allocator->free(allocator->context, ptr, size);
+}
+
+/**
+ * Checks whether a backing allocator can resize blocks.
+ * @param allocator The allocator or NULL for malloc
+ * @return true if ArenaAllocator_realloc may be used
+ */
+static inline bool ArenaAllocator_can_realloc(const ArenaAllocator *allocator) {
+    return allocator == NULL || allocator->realloc != NULL;
+}
+
+/**
+ * Resize memory of a backing allocator, see ArenaAllocator_can_realloc.
+ * @param allocator The allocator or NULL for realloc
+ * @param ptr The memory block
+ * @param old_size The size of the memory block as passed to ArenaAllocator_alloc
+ * @param new_size The new size
+ * @return Pointer to the resized block or NULL if allocation failed, ptr stays valid then
+ */
+static inline void *ArenaAllocator_realloc(const ArenaAllocator *allocator, void *ptr, const size_t old_size,
+                                           const size_t new_size) {
+    if (allocator == NULL) return realloc(ptr, new_size);
+    return allocator->realloc(allocator->context, ptr, old_size, new_size);
+}
+
+#ifdef ARENA_HAS_MMAP
+/**
+ * A read-only file mapping owned by an arena, see Arena_map_file. The record is allocated from the
+ * arena it belongs to, the mappings of an arena form a list starting with the most recent one.
+ */
+typedef struct arena_mapping_t {
+    struct arena_mapping_t *next;
+    void *data;
+    size_t size;
+} ArenaMapping;
+
+/**
+ * Unmap the mappings of a list up to, but not including, stop. Must run before the memory of the
+ * records is released.
+ * @param mapping The most recent mapping or NULL
+ * @param stop The first mapping to keep or NULL to unmap all
+ * @return stop
+ */
+static ArenaMapping *ArenaMapping_release(ArenaMapping *mapping, ArenaMapping *stop) {
+    while (mapping != NULL && mapping != stop) {
+        ArenaMapping *next = mapping->next;
+        munmap(mapping->data, mapping->size);
+        mapping = next;
+    }
+    return stop;
+}
+#endif
 
 /**
  * Simple statically-sized arena allocator.
@@ -18,36 +212,331 @@ typedef struct arena_t {
     void * data;
     size_t capacity;
     size_t next_offset;
+    const ArenaAllocator *allocator;    // Backing allocator of data, NULL for malloc
+#ifdef ARENA_HAS_MMAP
+    ArenaMapping *mappings; // Files mapped with Arena_map_file, most recent first
+#endif
+#ifdef ARENA_DEBUG
+    size_t last_header;     // Offset of the header of the most recent allocation plus one, 0 for none
+#endif
+#ifdef ARENA_STATS
+    size_t requested;       // Bytes requested by the live allocations
+    size_t allocations;     // No. of live allocations
+    size_t peak;            // Highest fill level before the last reset or rewind
+    size_t resets;          // No. of resets
+#endif
 } Arena;
 
+#ifdef ARENA_DEBUG
 /**
- * Initialize an arena.
+ * Header in front of every allocation of a debug build. The headers chain all allocations of an
+ * arena from the most recent one backwards, so the guard bytes can be verified.
+ */
+typedef struct arena_debug_header_t {
+    size_t previous;        // last_header before this allocation
+    size_t size;            // Size of the allocation
+} ArenaDebugHeader;
+
+/**
+ * Report a corrupted arena and abort.
+ * @param message What went wrong
+ * @param ptr The allocation concerned
+ * @param size The size of the allocation
+ */
+static ARENA_COLD void Arena_debug_fail(const char *message, const void *ptr, const size_t size) {
+    fprintf(stderr, "arena: %s (allocation %p, %zu bytes)\n", message, ptr, size);
+    abort();
+}
+
+/**
+ * Read the header of an allocation.
+ * @param arena The arena
+ * @param header_ref Offset of the header plus one
+ * @return The header
+ */
+static inline ArenaDebugHeader Arena_debug_header(const Arena *arena, const size_t header_ref) {
+    ArenaDebugHeader header;
+    char *ptr = (char *)arena->data + header_ref - 1;
+    ARENA_UNPOISON(ptr, sizeof(header));
+    memcpy(&header, ptr, sizeof(header));
+    ARENA_POISON(ptr, sizeof(header));
+    return header;
+}
+
+/**
+ * Write the header of an allocation.
+ * @param arena The arena
+ * @param header_ref Offset of the header plus one
+ * @param header The header
+ */
+static inline void Arena_debug_set_header(Arena *arena, const size_t header_ref, const ArenaDebugHeader header) {
+    char *ptr = (char *)arena->data + header_ref - 1;
+    ARENA_UNPOISON(ptr, sizeof(header));
+    memcpy(ptr, &header, sizeof(header));
+    ARENA_POISON(ptr, sizeof(header));
+}
+
+/**
+ * Verify the guard bytes of all allocations made since a save point, abort if any was
+ * overwritten.
+ * @param arena The arena
+ * @param stop last_header of the save point, 0 to check all allocations
+ */
+static void Arena_debug_check(const Arena *arena, const size_t stop) {
+    for (size_t ref = arena->last_header; ref != 0 && ref != stop;) {
+        const ArenaDebugHeader header = Arena_debug_header(arena, ref);
+        const unsigned char *ptr = (const unsigned char *)arena->data + ref - 1 + ARENA_ALLOC_HEADER_SIZE;
+        ARENA_UNPOISON(ptr + header.size, ARENA_GUARD_SIZE);
+        for (size_t i = 0; i < ARENA_GUARD_SIZE; i++)
+            if (ptr[header.size + i] != ARENA_GUARD_BYTE)
+                Arena_debug_fail("guard bytes overwritten, write past the end of an allocation", ptr, header.size);
+        ARENA_POISON(ptr + header.size, ARENA_GUARD_SIZE);
+        if (header.previous >= ref) Arena_debug_fail("allocation headers corrupted", ptr, header.size);
+        ref = header.previous;
+    }
+}
+
+/**
+ * Release the memory from an offset to the fill level: verify the guard bytes and poison it.
+ * @param arena The arena
+ * @param offset The new fill level
+ * @param last_header last_header at the new fill level
+ */
+static void Arena_debug_release(Arena *arena, const size_t offset, const size_t last_header) {
+    Arena_debug_check(arena, last_header);
+    ARENA_UNPOISON((char *)arena->data + offset, arena->next_offset - offset);
+    memset((char *)arena->data + offset, ARENA_POISON_BYTE, arena->next_offset - offset);
+    arena->last_header = last_header;
+}
+#endif
+
+/**
+ * Set up an arena on a block of memory.
+ * @param arena An empty arena struct
+ * @param data The memory block
+ * @param capacity Size of the memory block
+ * @param allocator The backing allocator that releases the block on Arena_free
+ */
+static void Arena_init_block(Arena *arena, void *data, const size_t capacity, const ArenaAllocator *allocator) {
+    arena->data = data;
+    arena->capacity = capacity;
+    arena->next_offset = 0;
+    arena->allocator = allocator;
+#ifdef ARENA_HAS_MMAP
+    arena->mappings = NULL;
+#endif
+#ifdef ARENA_DEBUG
+    arena->last_header = 0;
+#endif
+#ifdef ARENA_STATS
+    arena->requested = 0;
+    arena->allocations = 0;
+    arena->peak = 0;
+    arena->resets = 0;
+#endif
+    ARENA_POISON(data, capacity);
+}
+
+/**
+ * Initialize an arena with memory from a backing allocator.
  * @param arena An empty arena struct
  * @param capacity No. of bytes to allocate
+ * @param allocator The backing allocator or NULL for malloc, must outlive the arena
  * @return true for success, false if allocation failed
  */
-bool Arena_init(Arena *arena, const size_t capacity) {
+bool Arena_init_with_allocator(Arena *arena, const size_t capacity, const ArenaAllocator *allocator) {
     if (arena == NULL) return false;
-    void *data = malloc(capacity);
+    void *data = ArenaAllocator_alloc(allocator, capacity);
     if (data == NULL) return false;
-    arena->data = data;
-    arena->capacity = capacity;
-    arena->next_offset = 0;
+    Arena_init_block(arena, data, capacity, allocator);
     return true;
 }
 
 /**
- * Allocate memory from the arena.
+ * Initialize an arena.
+ * @param arena An empty arena struct
+ * @param capacity No. of bytes to allocate
+ * @return true for success, false if allocation failed
+ */
+bool Arena_init(Arena *arena, const size_t capacity) {
+    return Arena_init_with_allocator(arena, capacity, NULL);
+}
+
+/**
+ * Checks whether an alignment is supported by the aligned allocation functions.
+ * @param alignment The alignment in bytes
+ * @return true if alignment is a power of two not bigger than ARENA_MAX_ALIGNMENT
+ */
+static inline bool Arena_valid_alignment(const size_t alignment) {
+    return alignment != 0 && alignment <= ARENA_MAX_ALIGNMENT && (alignment & (alignment - 1)) == 0;
+}
+
+/**
+ * Returns the offset of the next allocation with the given alignment, which may be beyond the
+ * capacity of the arena.
+ * @param arena The arena
+ * @param alignment A valid alignment
+ * @return Offset from the start of the arena data
+ */
+static inline size_t Arena_aligned_offset(const Arena *arena, const size_t alignment) {
+    const uintptr_t base = (uintptr_t)arena->data;
+    const uintptr_t address = (base + arena->next_offset + ARENA_ALLOC_HEADER_SIZE + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    return address - base;
+}
+
+/**
+ * Checks whether an allocation fits at an offset. Overflow safe for any size.
+ * @param arena The arena
+ * @param offset Offset of the allocation
+ * @param size No. of bytes of the allocation
+ * @return true if the allocation and its guard bytes fit into the arena
+ */
+static inline bool Arena_fits(const Arena *arena, const size_t offset, const size_t size) {
+#if ARENA_GUARD_SIZE > 0
+    return offset <= arena->capacity && size <= arena->capacity - offset &&
+           ARENA_GUARD_SIZE <= arena->capacity - offset - size;
+#else
+    return offset <= arena->capacity && size <= arena->capacity - offset;
+#endif
+}
+
+/**
+ * Hand out an allocation that fits: record it and advance the fill level.
+ * @param arena The arena
+ * @param offset Offset of the allocation
+ * @param size No. of bytes of the allocation
+ * @return Pointer to the memory block
+ */
+static inline void *Arena_commit_alloc(Arena *arena, const size_t offset, const size_t size) {
+    char *mem = (char *)arena->data + offset;
+    ARENA_UNPOISON(mem, size);
+#ifdef ARENA_DEBUG
+    const ArenaDebugHeader header = { .previous = arena->last_header, .size = size };
+    Arena_debug_set_header(arena, offset - ARENA_ALLOC_HEADER_SIZE + 1, header);
+    arena->last_header = offset - ARENA_ALLOC_HEADER_SIZE + 1;
+    memset(mem, ARENA_FRESH_BYTE, size);
+    ARENA_UNPOISON(mem + size, ARENA_GUARD_SIZE);
+    memset(mem + size, ARENA_GUARD_BYTE, ARENA_GUARD_SIZE);
+    ARENA_POISON(mem + size, ARENA_GUARD_SIZE);
+#endif
+#ifdef ARENA_STATS
+    arena->requested += size;
+    arena->allocations++;
+#endif
+    arena->next_offset = offset + size + ARENA_GUARD_SIZE;
+    return mem;
+}
+
+/**
+ * Allocate aligned memory from the arena.
  * @param arena The arena
  * @param size No. of bytes to allocate in the arena
+ * @param alignment Alignment of the memory block, a power of two up to ARENA_MAX_ALIGNMENT
  * @return Pointer to the memory block or NULL if there was not enough memory left
  */
-void *Arena_alloc(Arena *arena, const size_t size) {
-    if (arena == NULL) return NULL;
-    if (arena->next_offset + size > arena->capacity) return NULL;
+static inline void *Arena_alloc_aligned(Arena *arena, const size_t size, const size_t alignment) {
+    ARENA_CHECK(arena != NULL, NULL);
+    if (!Arena_valid_alignment(alignment)) return NULL;
+    const size_t offset = Arena_aligned_offset(arena, alignment);
+    if (!Arena_fits(arena, offset, size)) return NULL;
+    return Arena_commit_alloc(arena, offset, size);
+}
+
+/**
+ * Allocate a contiguous array of objects from the arena.
+ * @param arena The arena
+ * @param count No. of objects
+ * @param size Size of a single object in bytes, a multiple of alignment keeps every object aligned
+ * @param alignment Alignment of the array, a power of two up to ARENA_MAX_ALIGNMENT
+ * @return Pointer to the first object or NULL if there was not enough memory left
+ */
+void *Arena_alloc_array(Arena *arena, const size_t count, const size_t size, const size_t alignment) {
+    if (size != 0 && count > SIZE_MAX / size) return NULL;
+    return Arena_alloc_aligned(arena, count * size, alignment);
+}
+
+/**
+ * Allocate memory from the arena. The memory is not aligned, unless ARENA_ALIGN_BY_DEFAULT is
+ * defined, in which case it is aligned to ARENA_DEFAULT_ALIGNMENT.
+ * @param arena The arena
+ * @param size No. of bytes to allocate in the arena
+ * @return Pointer to the memory block or NULL if there was not enough memory left
+ */
+static inline void *Arena_alloc(Arena *arena, const size_t size) {
+#if defined(ARENA_ALIGN_BY_DEFAULT)
+    return Arena_alloc_aligned(arena, size, ARENA_DEFAULT_ALIGNMENT);
+#elif defined(ARENA_DEBUG) || defined(ARENA_SANITIZE)
+    return Arena_alloc_aligned(arena, size, 1);
+#else
+    if (size > arena->capacity - arena->next_offset) return NULL;
     const size_t offset = arena->next_offset;
     arena->next_offset = offset + size;
-    return arena->data + offset;
+#ifdef ARENA_STATS
+    arena->requested += size;
+    arena->allocations++;
+#endif
+    return (char *)arena->data + offset;
+#endif
+}
+
+/**
+ * Resize the most recent allocation of the arena in place.
+ * @param arena The arena
+ * @param ptr The memory block
+ * @param old_size Current size of the memory block
+ * @param new_size Requested size of the memory block
+ * @return true if ptr is the most recent allocation and the arena has enough room left
+ */
+static inline bool Arena_resize_last(Arena *arena, void *ptr, const size_t old_size, const size_t new_size) {
+    const char *data = arena->data;
+    if ((const char *)ptr < data || (const char *)ptr + old_size + ARENA_GUARD_SIZE != data + arena->next_offset) return false;
+    const size_t offset = (size_t)((const char *)ptr - data);
+    if (!Arena_fits(arena, offset, new_size)) return false;
+#ifdef ARENA_DEBUG
+    const size_t header_ref = offset - ARENA_ALLOC_HEADER_SIZE + 1;
+    if (arena->last_header != header_ref) return false;
+    ArenaDebugHeader header = Arena_debug_header(arena, header_ref);
+    if (header.size != old_size) Arena_debug_fail("resized with a wrong old size", ptr, header.size);
+    Arena_debug_check(arena, header.previous);
+#endif
+
+    // Reopen the block with its red zone, the tail beyond the new size is poisoned again below
+    const size_t span = (old_size > new_size ? old_size : new_size) + ARENA_GUARD_SIZE;
+    ARENA_UNPOISON(ptr, span);
+#ifdef ARENA_DEBUG
+    header.size = new_size;
+    Arena_debug_set_header(arena, header_ref, header);
+    if (new_size > old_size) memset((char *)ptr + old_size, ARENA_FRESH_BYTE, new_size - old_size);
+    else memset((char *)ptr + new_size, ARENA_POISON_BYTE, old_size - new_size);
+    memset((char *)ptr + new_size, ARENA_GUARD_BYTE, ARENA_GUARD_SIZE);
+#endif
+    ARENA_POISON((char *)ptr + new_size, span - new_size);
+#ifdef ARENA_STATS
+    arena->requested = arena->requested - old_size + new_size;
+#endif
+    arena->next_offset = offset + new_size + ARENA_GUARD_SIZE;
+    return true;
+}
+
+/**
+ * Resize a memory block of the arena. The most recent allocation is grown or shrunk in place if
+ * there is enough room left, otherwise a new block aligned to ARENA_DEFAULT_ALIGNMENT is allocated
+ * and the contents are copied.
+ * @param arena The arena
+ * @param ptr The memory block or NULL to allocate a new one
+ * @param old_size Current size of the memory block
+ * @param new_size Requested size of the memory block
+ * @return Pointer to the memory block or NULL if there was not enough memory left
+ */
+void *Arena_realloc(Arena *arena, void *ptr, const size_t old_size, const size_t new_size) {
+    if (arena == NULL) return NULL;
+    if (ptr == NULL) return Arena_alloc_aligned(arena, new_size, ARENA_DEFAULT_ALIGNMENT);
+    if (Arena_resize_last(arena, ptr, old_size, new_size)) return ptr;
+
+    void *mem = Arena_alloc_aligned(arena, new_size, ARENA_DEFAULT_ALIGNMENT);
+    if (mem == NULL) return NULL;
+    memcpy(mem, ptr, old_size < new_size ? old_size : new_size);
+    return mem;
 }
 
 /**
@@ -56,16 +545,98 @@ void *Arena_alloc(Arena *arena, const size_t size) {
  */
 void Arena_reset(Arena *arena) {
     if (arena == NULL) return;
+#ifdef ARENA_HAS_MMAP
+    arena->mappings = ArenaMapping_release(arena->mappings, NULL);
+#endif
+#ifdef ARENA_DEBUG
+    Arena_debug_release(arena, 0, 0);
+#endif
+    ARENA_POISON(arena->data, arena->next_offset);
+#ifdef ARENA_STATS
+    if (arena->next_offset > arena->peak) arena->peak = arena->next_offset;
+    arena->requested = 0;
+    arena->allocations = 0;
+    arena->resets++;
+#endif
     arena->next_offset = 0;
 }
 
+/**
+ * A save point of an arena, see Arena_mark.
+ */
+typedef struct arena_mark_t {
+    size_t offset;
+#ifdef ARENA_HAS_MMAP
+    ArenaMapping *mappings;
+#endif
+#ifdef ARENA_DEBUG
+    size_t last_header;
+#endif
+#ifdef ARENA_STATS
+    size_t requested;
+    size_t allocations;
+#endif
+} ArenaMark;
+
+/**
+ * Capture the current fill level of the arena.
+ * @param arena The arena
+ * @return A mark to pass to Arena_rewind
+ */
+ArenaMark Arena_mark(const Arena *arena) {
+    ArenaMark mark = { .offset = 0 };
+    if (arena == NULL) return mark;
+    mark.offset = arena->next_offset;
+#ifdef ARENA_HAS_MMAP
+    mark.mappings = arena->mappings;
+#endif
+#ifdef ARENA_DEBUG
+    mark.last_header = arena->last_header;
+#endif
+#ifdef ARENA_STATS
+    mark.requested = arena->requested;
+    mark.allocations = arena->allocations;
+#endif
+    return mark;
+}
+
+/**
+ * Release all memory allocated after the mark was taken. Marks taken after this mark, and marks
+ * taken before a reset, become invalid.
+ * @param arena The arena
+ * @param mark A mark returned by Arena_mark
+ */
+void Arena_rewind(Arena *arena, const ArenaMark mark) {
+    if (arena == NULL || mark.offset > arena->next_offset) return;
+#ifdef ARENA_HAS_MMAP
+    arena->mappings = ArenaMapping_release(arena->mappings, mark.mappings);
+#endif
+#ifdef ARENA_DEBUG
+    Arena_debug_release(arena, mark.offset, mark.last_header);
+#endif
+    ARENA_POISON((char *)arena->data + mark.offset, arena->next_offset - mark.offset);
+#ifdef ARENA_STATS
+    if (arena->next_offset > arena->peak) arena->peak = arena->next_offset;
+    arena->requested = mark.requested;
+    arena->allocations = mark.allocations;
+#endif
+    arena->next_offset = mark.offset;
+}
+
 /**
  * Release the memory allocated by the arena. After this call, the arena cannot be used anymore.
  * @param arena The arena to free.
  */
 void Arena_free(Arena *arena) {
     if (arena != NULL && arena->data != NULL) {
-        free(arena->data);
+#ifdef ARENA_HAS_MMAP
+        arena->mappings = ArenaMapping_release(arena->mappings, NULL);
+#endif
+#ifdef ARENA_DEBUG
+        Arena_debug_check(arena, 0);
+#endif
+        ARENA_UNPOISON(arena->data, arena->capacity);
+        ArenaAllocator_free(arena->allocator, arena->data, arena->capacity);
         arena->data = NULL;
     }
 }
@@ -81,100 +652,1875 @@ size_t Arena_remaining(const Arena *arena) {
 }
 
 /**
- * Growable arena allocator.
- *
- * This allocator can grow (but not shrink) dynamically by allocating pages of memory as needed.
- * Is uses the simple allocator under the hood and maintains a list of them to find a free memory
- * block and automatically adds new pages as needed. Allocation is therefore slightly more expensive.
+ * The offset that stands for NULL, see Arena_offset.
  */
-typedef struct growable_arena_t {
-    size_t page_size;
-    size_t pages;
-    Arena *base_arena;
-} GrowableArena;
+#define ARENA_NULL_OFFSET SIZE_MAX
 
 /**
- * Initialize a growable arena.
- * @param arena An empty GrowableArena struct
- * @param page_size The size of a single page in bytes
- * @return true for success, false if allocation failed
+ * Offset of memory of the arena from the start of its data. Offsets stay valid when the arena
+ * data is saved and loaded at another address, see Arena_save.
+ * @param arena The arena
+ * @param ptr Memory allocated from the arena
+ * @return The offset or ARENA_NULL_OFFSET if ptr is NULL or not in the arena
  */
-bool GrowableArena_init(GrowableArena *arena, const size_t page_size) {
-    if (arena == NULL) return false;
-
-    Arena* base = malloc(sizeof(Arena));
-    if (!base) return false;
-    Arena_init(base, page_size);
-    arena->page_size = page_size;
-    arena->base_arena = base;
-    arena->pages = 1;
-    return true;
+static inline size_t Arena_offset(const Arena *arena, const void *ptr) {
+    if (arena == NULL || ptr == NULL) return ARENA_NULL_OFFSET;
+    const uintptr_t address = (uintptr_t)ptr, data = (uintptr_t)arena->data;
+    if (address < data || address - data >= arena->capacity) return ARENA_NULL_OFFSET;
+    return (size_t)(address - data);
 }
 
 /**
- * Allocate memory from the growable arena.
- * @param arena The growable arena
- * @param size No. of bytes to allocate
- * @return Pointer to the memory block or NULL if there was not enough memory left
+ * Memory of the arena at an offset, see Arena_offset.
+ * @param arena The arena
+ * @param offset The offset
+ * @return Pointer to the memory or NULL for ARENA_NULL_OFFSET or an offset outside the arena
  */
-void *GrowableArena_alloc(GrowableArena *arena, const size_t size) {
-    if (arena == NULL) return NULL;
-    size_t current_page = 0;
-
-    for (;;) {
-        // Find a free memory segment
-        for (size_t i = current_page; i < arena->pages; ++i) {
-            void* mem = Arena_alloc((arena->base_arena)+i, size);
-            if (mem) return mem;
-        }
+static inline void *Arena_at(const Arena *arena, const size_t offset) {
+    if (arena == NULL || offset >= arena->capacity) return NULL;
+    return (char *)arena->data + offset;
+}
 
-        // Still here, meaning we have not found a free memory block yet. Allocate a new page.
-        Arena* base = realloc(arena->base_arena, sizeof(Arena)*(arena->pages+1));
-        if (!base) return false;
+/**
+ * A self-relative pointer: the distance from its own address to the target, 0 for NULL. Data
+ * structures linked with relative pointers can be moved, saved and mapped at any address as a
+ * whole without fixing up pointers.
+ */
+typedef struct arena_rel_ptr_t {
+    int64_t offset;
+} ArenaRelPtr;
 
-        if (!Arena_init(base+current_page+1, arena->page_size)) return false;
-        arena->base_arena = base;
-        arena->pages++;
-        current_page++;
-    }
+/**
+ * Point a relative pointer to a target.
+ * @param rel The relative pointer, must live in the same block of memory as the target
+ * @param target The target or NULL
+ */
+static inline void ArenaRelPtr_set(ArenaRelPtr *rel, const void *target) {
+    rel->offset = target == NULL ? 0 : (int64_t)((intptr_t)target - (intptr_t)rel);
 }
 
 /**
- * Resets all the arena pages to zero, meaning the memory is fully available.
- * @param arena The growable arena to reset
+ * Resolve a relative pointer.
+ * @param rel The relative pointer
+ * @return The target or NULL
  */
-void GrowableArena_reset(GrowableArena *arena) {
-    for (size_t i = 0; i < arena->pages; ++i)
-        Arena_reset((arena->base_arena)+i);
+static inline void *ArenaRelPtr_get(const ArenaRelPtr *rel) {
+    return rel->offset == 0 ? NULL : (void *)((intptr_t)rel + (intptr_t)rel->offset);
 }
 
+#ifdef ARENA_STATS
 /**
- * Release the memory allocated by the arena. After this call, the arena cannot be used anymore.
- * @param arena The arena to free.
+ * Snapshot of the allocation statistics of an arena, see Arena_stats. Defining ARENA_STATS keeps
+ * the counters up to date, the fast paths pay two additions per allocation.
  */
-void GrowableArena_free(GrowableArena *arena) {
-    if (arena != NULL) {
-        for (size_t i = 0; i < arena->pages; ++i)
-            Arena_free(arena->base_arena);
+typedef struct arena_stats_t {
+    size_t requested;       // Bytes requested by the live allocations
+    size_t used;            // Bytes taken by the live allocations, including padding and page tails left behind
+    size_t committed;       // Bytes of memory held from the backing allocator
+    size_t peak;            // Highest value of used
+    size_t allocations;     // No. of live allocations
+    size_t pages;           // No. of pages
+    size_t large_blocks;    // No. of large blocks
+    size_t resets;          // No. of resets
+    double fragmentation;   // Share of used that was not requested
+} ArenaStats;
 
-        free(arena->base_arena);
-        arena->base_arena = NULL;
-    }
+/**
+ * Returns the share of the used bytes that was not requested.
+ * @param stats The statistics
+ * @return A value between 0 and 1
+ */
+static inline double ArenaStats_fragmentation(const ArenaStats *stats) {
+    if (stats->used == 0) return 0.0;
+    return (double)(stats->used - stats->requested) / (double)stats->used;
 }
 
 /**
- * Returns the amount of available bytes left for allocation.
- * @param arena
- * @return Number of bytes available.
+ * Take a snapshot of the allocation statistics of an arena in constant time.
+ * @param arena The arena
+ * @return The statistics, all zero for NULL
  */
-size_t GrowableArena_remaining(const GrowableArena *arena) {
-    if (arena == NULL) return 0;
+ArenaStats Arena_stats(const Arena *arena) {
+    ArenaStats stats = {0};
+    if (arena == NULL || arena->data == NULL) return stats;
+    stats.requested = arena->requested;
+    stats.used = arena->next_offset;
+    stats.committed = arena->capacity;
+    stats.peak = arena->peak > arena->next_offset ? arena->peak : arena->next_offset;
+    stats.allocations = arena->allocations;
+    stats.pages = 1;
+    stats.resets = arena->resets;
+    stats.fragmentation = ArenaStats_fragmentation(&stats);
+    return stats;
+}
+#endif
 
-    size_t capacity = 0;
-    for (size_t i = 0; i < arena->pages; ++i)
-        capacity += Arena_remaining((arena->base_arena)+i);
+/**
+ * A page of a growable arena. The header sits at the start of the memory block it describes,
+ * the page data follows right after it.
+ */
+typedef struct arena_page_t {
+    struct arena_page_t *next;
+    Arena arena;
+} ArenaPage;
 
-    return capacity;
-}
+/**
+ * Size of the page header, rounded up so the page data keeps the alignment of malloc.
+ */
+#define ARENA_PAGE_HEADER_SIZE \
+    ((sizeof(ArenaPage) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+
+/**
+ * Page growth policy of a growable arena.
+ */
+typedef enum arena_growth_t {
+    ARENA_GROWTH_FIXED,     // All pages have the same size
+    ARENA_GROWTH_DOUBLE,    // Every new page is twice the size of the previous one
+    ARENA_GROWTH_FACTOR,    // Every new page is growth_factor times the size of the previous one
+} ArenaGrowth;
+
+/**
+ * Options of a growable arena, see GrowableArena_init_with_options.
+ */
+typedef struct growable_arena_options_t {
+    size_t page_size;       // Size of the first page in bytes
+    ArenaGrowth growth;     // Page growth policy
+    double growth_factor;   // Factor for ARENA_GROWTH_FACTOR
+    size_t max_page_size;   // Pages do not grow beyond this size, 0 for no limit
+    size_t retain_pages;    // Reset keeps at most this many pages, 0 for no limit
+    size_t retain_bytes;    // Reset keeps at most this many bytes of pages, 0 for no limit
+    const ArenaAllocator *allocator;    // Backing allocator for pages and large blocks, NULL for malloc
+} GrowableArenaOptions;
+
+/**
+ * Growable arena allocator.
+ *
+ * This allocator can grow (but not shrink) dynamically by allocating pages of memory as needed.
+ * Is uses the simple allocator under the hood and maintains a linked list of pages. Allocations are
+ * bumped from the active page (current) in constant time, a new page is only added when the active
+ * one is full. Adding a page costs a single allocation and never moves existing pages.
+ *
+ * Requests that do not fit into a page get a dedicated block (large), which is released by reset.
+ *
+ * By default all pages have the same size, a growth policy makes new pages grow geometrically so a
+ * burst of allocations only needs a logarithmic number of pages. page_size is the size of the next
+ * new page.
+ */
+typedef struct growable_arena_t {
+    GrowableArenaOptions options;
+    size_t page_size;
+    size_t pages;
+    ArenaPage *first;
+    ArenaPage *current;
+    ArenaPage *large;
+    size_t large_blocks;
+#ifdef ARENA_HAS_MMAP
+    ArenaMapping *mappings; // Files mapped with GrowableArena_map_file, most recent first
+#endif
+#ifdef ARENA_STATS
+    ArenaStats stats;       // Counters of the pages before the active one and of the large blocks
+#endif
+} GrowableArena;
+
+/**
+ * Allocate a new page with header and data in a single memory block.
+ * @param allocator The backing allocator or NULL for malloc
+ * @param capacity No. of bytes available in the page
+ * @return The new page or NULL if allocation failed
+ */
+static ArenaPage *ArenaPage_new(const ArenaAllocator *allocator, const size_t capacity) {
+    if (capacity > SIZE_MAX - ARENA_PAGE_HEADER_SIZE) return NULL;
+    ArenaPage *page = ArenaAllocator_alloc(allocator, ARENA_PAGE_HEADER_SIZE + capacity);
+    if (page == NULL) return NULL;
+    page->next = NULL;
+    page->arena.data = (char *)page + ARENA_PAGE_HEADER_SIZE;
+    page->arena.capacity = capacity;
+    page->arena.next_offset = 0;
+    page->arena.allocator = NULL;
+#ifdef ARENA_HAS_MMAP
+    page->arena.mappings = NULL;
+#endif
+#ifdef ARENA_DEBUG
+    page->arena.last_header = 0;
+#endif
+#ifdef ARENA_STATS
+    page->arena.requested = 0;
+    page->arena.allocations = 0;
+    page->arena.peak = 0;
+    page->arena.resets = 0;
+#endif
+    ARENA_POISON(page->arena.data, capacity);
+    return page;
+}
+
+/**
+ * Release a page.
+ * @param allocator The backing allocator the page was allocated with
+ * @param page The page
+ */
+static inline void ArenaPage_free(const ArenaAllocator *allocator, ArenaPage *page) {
+#ifdef ARENA_DEBUG
+    Arena_debug_check(&page->arena, 0);
+#endif
+    ARENA_UNPOISON(page->arena.data, page->arena.capacity);
+    ArenaAllocator_free(allocator, page, ARENA_PAGE_HEADER_SIZE + page->arena.capacity);
+}
+
+/**
+ * Release a list of pages.
+ * @param allocator The backing allocator the pages were allocated with
+ * @param page The first page of the list
+ */
+static void ArenaPage_free_list(const ArenaAllocator *allocator, ArenaPage *page) {
+    while (page != NULL) {
+        ArenaPage *next = page->next;
+        ArenaPage_free(allocator, page);
+        page = next;
+    }
+}
+
+/**
+ * Returns the worst case padding needed to align an allocation at the start of a page, including
+ * the per allocation overhead of debug builds.
+ * @param alignment The alignment in bytes
+ * @return Padding in bytes
+ */
+static inline size_t ArenaPage_padding(const size_t alignment) {
+    // Page data is aligned to ARENA_DEFAULT_ALIGNMENT, bigger alignments may need padding
+    return (alignment > ARENA_DEFAULT_ALIGNMENT ? alignment - ARENA_DEFAULT_ALIGNMENT : 0) + ARENA_ALLOC_OVERHEAD;
+}
+
+/**
+ * Computes the size of the page following a page of the given size.
+ * @param options The arena options
+ * @param page_size The size of the previous page
+ * @return The size of the next page
+ */
+static size_t GrowableArena_grow_page_size(const GrowableArenaOptions *options, const size_t page_size) {
+    size_t next = page_size;
+    switch (options->growth) {
+        case ARENA_GROWTH_FIXED:
+            return page_size;
+        case ARENA_GROWTH_DOUBLE:
+            next = page_size > SIZE_MAX / 2 ? SIZE_MAX : page_size * 2;
+            break;
+        case ARENA_GROWTH_FACTOR: {
+            const double grown = (double)page_size * options->growth_factor;
+            next = grown >= (double)SIZE_MAX ? SIZE_MAX : (size_t)grown;
+            break;
+        }
+    }
+    if (options->max_page_size != 0 && next > options->max_page_size) next = options->max_page_size;
+    return next < page_size ? page_size : next;
+}
+
+/**
+ * Initialize a growable arena with a growth policy.
+ * @param arena An empty GrowableArena struct
+ * @param options The arena options, page_size is the size of the first page
+ * @return true for success, false if allocation failed
+ */
+bool GrowableArena_init_with_options(GrowableArena *arena, const GrowableArenaOptions *options) {
+    if (arena == NULL || options == NULL) return false;
+
+    ArenaPage *page = ArenaPage_new(options->allocator, options->page_size);
+    if (!page) return false;
+    arena->options = *options;
+    arena->page_size = GrowableArena_grow_page_size(options, options->page_size);
+    arena->pages = 1;
+    arena->first = page;
+    arena->current = page;
+    arena->large = NULL;
+    arena->large_blocks = 0;
+#ifdef ARENA_HAS_MMAP
+    arena->mappings = NULL;
+#endif
+#ifdef ARENA_STATS
+    arena->stats = (ArenaStats){ .committed = ARENA_PAGE_HEADER_SIZE + page->arena.capacity };
+#endif
+    return true;
+}
+
+/**
+ * Initialize a growable arena with pages of a fixed size.
+ * @param arena An empty GrowableArena struct
+ * @param page_size The size of a single page in bytes
+ * @return true for success, false if allocation failed
+ */
+bool GrowableArena_init(GrowableArena *arena, const size_t page_size) {
+    const GrowableArenaOptions options = {
+        .page_size = page_size,
+        .growth = ARENA_GROWTH_FIXED,
+    };
+    return GrowableArena_init_with_options(arena, &options);
+}
+
+/**
+ * Account for the active page before the arena moves on to the next one, its tail is left behind.
+ * @param arena The growable arena
+ */
+static inline void GrowableArena_leave_page(GrowableArena *arena) {
+#ifdef ARENA_STATS
+    const Arena *page = &arena->current->arena;
+    arena->stats.requested += page->requested;
+    arena->stats.used += page->capacity;
+    arena->stats.allocations += page->allocations;
+#else
+    (void)arena;
+#endif
+}
+
+/**
+ * Make the next page that can hold an allocation the active one. Pages kept by a reset are reused
+ * first, a new page is only added at the end of the list.
+ * @param arena The growable arena
+ * @param size No. of bytes the page must hold, including alignment padding
+ * @return true for success, false if allocation failed
+ */
+static bool GrowableArena_next_page(GrowableArena *arena, const size_t size) {
+    // Pages kept by a reset may be smaller than the request when the page size grows
+    while (arena->current->next != NULL) {
+        GrowableArena_leave_page(arena);
+        arena->current = arena->current->next;
+        if (arena->current->arena.capacity >= size) return true;
+    }
+
+    ArenaPage *page = ArenaPage_new(arena->options.allocator, arena->page_size);
+    if (!page) return false;
+    GrowableArena_leave_page(arena);
+#ifdef ARENA_STATS
+    arena->stats.committed += ARENA_PAGE_HEADER_SIZE + page->arena.capacity;
+#endif
+    arena->current->next = page;
+    arena->current = page;
+    arena->pages++;
+    arena->page_size = GrowableArena_grow_page_size(&arena->options, arena->page_size);
+    return true;
+}
+
+/**
+ * Allocate a dedicated block for a request that does not fit into a page. The active page is left
+ * untouched. Large blocks come straight from the backing allocator, malloc typically maps them
+ * with mmap.
+ * @param arena The growable arena
+ * @param size No. of bytes to allocate
+ * @param alignment Alignment of the memory block
+ * @return Pointer to the memory block or NULL if allocation failed
+ */
+static void *GrowableArena_alloc_large(GrowableArena *arena, const size_t size, const size_t alignment) {
+    const size_t padding = ArenaPage_padding(alignment);
+    if (size > SIZE_MAX - padding) return NULL;
+
+    ArenaPage *block = ArenaPage_new(arena->options.allocator, size + padding);
+    if (!block) return NULL;
+    block->next = arena->large;
+    arena->large = block;
+    arena->large_blocks++;
+#ifdef ARENA_STATS
+    arena->stats.requested += size;
+    arena->stats.used += block->arena.capacity;
+    arena->stats.committed += ARENA_PAGE_HEADER_SIZE + block->arena.capacity;
+    arena->stats.allocations++;
+#endif
+
+    return Arena_alloc_aligned(&block->arena, size, alignment);
+}
+
+/**
+ * Slow path of the growable arena allocation, taken when the active page is full.
+ * @param arena The growable arena
+ * @param size No. of bytes to allocate
+ * @param alignment A valid alignment
+ * @return Pointer to the memory block or NULL if allocation failed
+ */
+static ARENA_COLD void *GrowableArena_alloc_slow(GrowableArena *arena, const size_t size, const size_t alignment) {
+    // A request that would not fit into a new page either
+    const size_t padding = ArenaPage_padding(alignment);
+    if (padding > arena->page_size || size > arena->page_size - padding)
+        return GrowableArena_alloc_large(arena, size, alignment);
+
+    // The active page is full
+    if (!GrowableArena_next_page(arena, size + padding)) return NULL;
+
+    return Arena_alloc_aligned(&arena->current->arena, size, alignment);
+}
+
+/**
+ * Allocate memory from the growable arena. The memory is aligned like Arena_alloc.
+ * @param arena The growable arena
+ * @param size No. of bytes to allocate
+ * @return Pointer to the memory block or NULL if there was not enough memory left
+ */
+static inline void *GrowableArena_alloc(GrowableArena *arena, const size_t size) {
+    ARENA_CHECK(arena != NULL, NULL);
+
+    // Fast path: bump from the active page
+    void* mem = Arena_alloc(&arena->current->arena, size);
+    if (ARENA_LIKELY(mem != NULL)) return mem;
+
+#ifdef ARENA_ALIGN_BY_DEFAULT
+    return GrowableArena_alloc_slow(arena, size, ARENA_DEFAULT_ALIGNMENT);
+#else
+    return GrowableArena_alloc_slow(arena, size, 1);
+#endif
+}
+
+/**
+ * Allocate aligned memory from the growable arena.
+ * @param arena The growable arena
+ * @param size No. of bytes to allocate
+ * @param alignment Alignment of the memory block, a power of two up to ARENA_MAX_ALIGNMENT
+ * @return Pointer to the memory block or NULL if there was not enough memory left
+ */
+static inline void *GrowableArena_alloc_aligned(GrowableArena *arena, const size_t size, const size_t alignment) {
+    ARENA_CHECK(arena != NULL, NULL);
+    if (!Arena_valid_alignment(alignment)) return NULL;
+
+    // Fast path: bump from the active page
+    void* mem = Arena_alloc_aligned(&arena->current->arena, size, alignment);
+    if (ARENA_LIKELY(mem != NULL)) return mem;
+
+    return GrowableArena_alloc_slow(arena, size, alignment);
+}
+
+/**
+ * Allocate a contiguous array of objects from the growable arena. Arrays that do not fit into a
+ * page get a large block.
+ * @param arena The growable arena
+ * @param count No. of objects
+ * @param size Size of a single object in bytes, a multiple of alignment keeps every object aligned
+ * @param alignment Alignment of the array, a power of two up to ARENA_MAX_ALIGNMENT
+ * @return Pointer to the first object or NULL if there was not enough memory left
+ */
+void *GrowableArena_alloc_array(GrowableArena *arena, const size_t count, const size_t size, const size_t alignment) {
+    if (size != 0 && count > SIZE_MAX / size) return NULL;
+    return GrowableArena_alloc_aligned(arena, count * size, alignment);
+}
+
+/**
+ * Allocate a run of up to count objects in one call. The run is contiguous and takes as many
+ * objects as fit into the active page, a new page is only started when not a single object fits.
+ * Call it repeatedly until all objects are allocated, this fills every page to the end.
+ * @param arena The growable arena
+ * @param count No. of objects wanted
+ * @param size Size of a single object in bytes, a multiple of alignment keeps every object aligned
+ * @param alignment Alignment of the run, a power of two up to ARENA_MAX_ALIGNMENT
+ * @param allocated Receives the number of objects in the run
+ * @return Pointer to the first object of the run or NULL if allocation failed
+ */
+void *GrowableArena_alloc_batch(GrowableArena *arena, const size_t count, const size_t size,
+                                const size_t alignment, size_t *allocated) {
+    if (allocated == NULL) return NULL;
+    *allocated = 0;
+    if (arena == NULL || count == 0 || size == 0) return NULL;
+    if (!Arena_valid_alignment(alignment)) return NULL;
+
+    // A single object that does not fit into a page gets a large block
+    const size_t padding = ArenaPage_padding(alignment);
+    if (padding > arena->page_size || size > arena->page_size - padding) {
+        void *mem = GrowableArena_alloc_large(arena, size, alignment);
+        if (mem != NULL) *allocated = 1;
+        return mem;
+    }
+
+    for (;;) {
+        Arena *page = &arena->current->arena;
+        const size_t offset = Arena_aligned_offset(page, alignment);
+        const size_t fit = Arena_fits(page, offset, 0) ? (page->capacity - offset - ARENA_GUARD_SIZE) / size : 0;
+        if (fit > 0) {
+            const size_t objects = fit < count ? fit : count;
+            *allocated = objects;
+            return Arena_commit_alloc(page, offset, objects * size);
+        }
+        if (!GrowableArena_next_page(arena, size + padding)) return NULL;
+    }
+}
+
+/**
+ * Resize a memory block of the growable arena. The most recent allocation of the active page is
+ * grown or shrunk in place if the page has enough room left. The most recent large block starting
+ * at ptr is resized by the backing allocator if it supports realloc, it may move then. Otherwise a
+ * new block aligned to ARENA_DEFAULT_ALIGNMENT is allocated and the contents are copied.
+ * @param arena The growable arena
+ * @param ptr The memory block or NULL to allocate a new one
+ * @param old_size Current size of the memory block
+ * @param new_size Requested size of the memory block
+ * @return Pointer to the memory block or NULL if there was not enough memory left
+ */
+void *GrowableArena_realloc(GrowableArena *arena, void *ptr, const size_t old_size, const size_t new_size) {
+    if (arena == NULL) return NULL;
+    if (ptr == NULL) return GrowableArena_alloc_aligned(arena, new_size, ARENA_DEFAULT_ALIGNMENT);
+    if (Arena_resize_last(&arena->current->arena, ptr, old_size, new_size)) return ptr;
+
+    // A large block that holds nothing but ptr can be resized as a whole by the backing allocator
+    ArenaPage *block = arena->large;
+    const ArenaAllocator *allocator = arena->options.allocator;
+    if (ARENA_ALLOC_OVERHEAD == 0 && block != NULL && ArenaAllocator_can_realloc(allocator) &&
+        ptr == block->arena.data && old_size == block->arena.next_offset && new_size > arena->page_size &&
+        new_size <= SIZE_MAX - ARENA_PAGE_HEADER_SIZE) {
+        block = ArenaAllocator_realloc(allocator, block, ARENA_PAGE_HEADER_SIZE + block->arena.capacity,
+                                       ARENA_PAGE_HEADER_SIZE + new_size);
+        if (block == NULL) return NULL;
+#ifdef ARENA_STATS
+        arena->stats.requested = arena->stats.requested - old_size + new_size;
+        arena->stats.used = arena->stats.used - block->arena.capacity + new_size;
+        arena->stats.committed = arena->stats.committed - block->arena.capacity + new_size;
+#endif
+        block->arena.data = (char *)block + ARENA_PAGE_HEADER_SIZE;
+        block->arena.capacity = new_size;
+        block->arena.next_offset = new_size;
+        arena->large = block;
+        return block->arena.data;
+    }
+
+    void *mem = GrowableArena_alloc_aligned(arena, new_size, ARENA_DEFAULT_ALIGNMENT);
+    if (mem == NULL) return NULL;
+    memcpy(mem, ptr, old_size < new_size ? old_size : new_size);
+    return mem;
+}
+
+/**
+ * Resets all the arena pages to zero, meaning the memory is fully available. Large blocks are
+ * released. Pages beyond the retain_pages and retain_bytes limits are released as well, the first
+ * page is always kept. A new page then grows from the last page kept, so reset cycles with the
+ * same workload reuse the same page sizes.
+ * @param arena The growable arena to reset
+ */
+void GrowableArena_reset(GrowableArena *arena) {
+    if (arena == NULL) return;
+#ifdef ARENA_HAS_MMAP
+    arena->mappings = ArenaMapping_release(arena->mappings, NULL);
+#endif
+#ifdef ARENA_STATS
+    const size_t used = arena->stats.used + arena->current->arena.next_offset;
+    if (used > arena->stats.peak) arena->stats.peak = used;
+#endif
+
+    const GrowableArenaOptions *options = &arena->options;
+    ArenaPage *last = arena->first;
+    size_t pages = 1;
+    size_t bytes = last->arena.capacity;
+    Arena_reset(&last->arena);
+    while (last->next != NULL) {
+        ArenaPage *page = last->next;
+        if (options->retain_pages != 0 && pages + 1 > options->retain_pages) break;
+        if (options->retain_bytes != 0 && bytes + page->arena.capacity > options->retain_bytes) break;
+        Arena_reset(&page->arena);
+        pages++;
+        bytes += page->arena.capacity;
+        last = page;
+    }
+
+    // Pages are sized in order, the next new page follows the last one kept
+    if (last->next != NULL) arena->page_size = GrowableArena_grow_page_size(options, last->arena.capacity);
+    ArenaPage_free_list(options->allocator, last->next);
+    last->next = NULL;
+    arena->pages = pages;
+    arena->current = arena->first;
+
+    ArenaPage_free_list(options->allocator, arena->large);
+    arena->large = NULL;
+    arena->large_blocks = 0;
+#ifdef ARENA_STATS
+    arena->stats.requested = 0;
+    arena->stats.used = 0;
+    arena->stats.allocations = 0;
+    arena->stats.committed = pages * ARENA_PAGE_HEADER_SIZE + bytes;
+    arena->stats.resets++;
+#endif
+}
+
+/**
+ * A save point of a growable arena, see GrowableArena_mark.
+ */
+typedef struct growable_arena_mark_t {
+    ArenaPage *page;
+    ArenaMark page_mark;
+    size_t large_blocks;    // Large blocks are counted, realloc may move the newest one
+#ifdef ARENA_HAS_MMAP
+    ArenaMapping *mappings;
+#endif
+#ifdef ARENA_STATS
+    ArenaStats stats;
+#endif
+} GrowableArenaMark;
+
+/**
+ * Capture the current fill level of the growable arena.
+ * @param arena The growable arena
+ * @return A mark to pass to GrowableArena_rewind
+ */
+GrowableArenaMark GrowableArena_mark(const GrowableArena *arena) {
+    GrowableArenaMark mark = {0};
+    if (arena == NULL) return mark;
+    mark.page = arena->current;
+    mark.page_mark = Arena_mark(&arena->current->arena);
+    mark.large_blocks = arena->large_blocks;
+#ifdef ARENA_HAS_MMAP
+    mark.mappings = arena->mappings;
+#endif
+#ifdef ARENA_STATS
+    mark.stats = arena->stats;
+#endif
+    return mark;
+}
+
+/**
+ * Release all memory allocated after the mark was taken, across page boundaries. Large blocks
+ * allocated after the mark are released. Marks taken after this mark, and marks taken before a
+ * reset, become invalid.
+ * @param arena The growable arena
+ * @param mark A mark returned by GrowableArena_mark
+ */
+void GrowableArena_rewind(GrowableArena *arena, const GrowableArenaMark mark) {
+    if (arena == NULL || mark.page == NULL) return;
+#ifdef ARENA_HAS_MMAP
+    arena->mappings = ArenaMapping_release(arena->mappings, mark.mappings);
+#endif
+#ifdef ARENA_STATS
+    const size_t used = arena->stats.used + arena->current->arena.next_offset;
+    if (used > arena->stats.peak) arena->stats.peak = used;
+    arena->stats.requested = mark.stats.requested;
+    arena->stats.used = mark.stats.used;
+    arena->stats.allocations = mark.stats.allocations;
+#endif
+
+    // Pages after the marked one up to the active page were filled after the mark
+    if (mark.page != arena->current) {
+        for (ArenaPage *page = mark.page->next; page != NULL; page = page->next) {
+            Arena_reset(&page->arena);
+            if (page == arena->current) break;
+        }
+    }
+    Arena_rewind(&mark.page->arena, mark.page_mark);
+    arena->current = mark.page;
+
+    while (arena->large_blocks > mark.large_blocks && arena->large != NULL) {
+        ArenaPage *next = arena->large->next;
+#ifdef ARENA_STATS
+        arena->stats.committed -= ARENA_PAGE_HEADER_SIZE + arena->large->arena.capacity;
+#endif
+        ArenaPage_free(arena->options.allocator, arena->large);
+        arena->large = next;
+        arena->large_blocks--;
+    }
+}
+
+/**
+ * Release the memory allocated by the arena. After this call, the arena cannot be used anymore.
+ * @param arena The arena to free.
+ */
+void GrowableArena_free(GrowableArena *arena) {
+    if (arena != NULL) {
+#ifdef ARENA_HAS_MMAP
+        arena->mappings = ArenaMapping_release(arena->mappings, NULL);
+#endif
+        ArenaPage_free_list(arena->options.allocator, arena->first);
+        ArenaPage_free_list(arena->options.allocator, arena->large);
+
+        arena->first = NULL;
+        arena->current = NULL;
+        arena->pages = 0;
+        arena->large = NULL;
+        arena->large_blocks = 0;
+#ifdef ARENA_STATS
+        arena->stats = (ArenaStats){0};
+#endif
+    }
+}
+
+/**
+ * Returns the amount of available bytes left for allocation in the pages. Large blocks are not
+ * counted.
+ * @param arena
+ * @return Number of bytes available.
+ */
+size_t GrowableArena_remaining(const GrowableArena *arena) {
+    if (arena == NULL) return 0;
+
+    size_t capacity = 0;
+    for (const ArenaPage *page = arena->first; page != NULL; page = page->next)
+        capacity += Arena_remaining(&page->arena);
+
+    return capacity;
+}
+
+/**
+ * ArenaAllocator callbacks drawing from a parent growable arena, see GrowableArena_allocator.
+ */
+static void *GrowableArena_allocator_alloc(void *context, size_t size) {
+    return GrowableArena_alloc_aligned(context, size, ARENA_DEFAULT_ALIGNMENT);
+}
+
+static void GrowableArena_allocator_free(void *context, void *ptr, size_t size) {
+    // Hands the block back if nothing was allocated from the parent after it
+    GrowableArena *parent = context;
+    Arena_resize_last(&parent->current->arena, ptr, size, 0);
+}
+
+static void *GrowableArena_allocator_realloc(void *context, void *ptr, size_t old_size, size_t new_size) {
+    return GrowableArena_realloc(context, ptr, old_size, new_size);
+}
+
+/**
+ * A backing allocator that draws from a parent growable arena, to stack arenas. Memory a child
+ * releases goes back to the parent only if it is the most recent allocation of the parent,
+ * everything else is released when the parent is reset or rewound.
+ * @param parent The parent arena, must outlive the arenas using the allocator
+ * @return The allocator, must outlive the arenas using it as well
+ */
+ArenaAllocator GrowableArena_allocator(GrowableArena *parent) {
+    return (ArenaAllocator){
+        .alloc = GrowableArena_allocator_alloc,
+        .free = GrowableArena_allocator_free,
+        .context = parent,
+        .realloc = GrowableArena_allocator_realloc,
+    };
+}
+
+/**
+ * Header in front of the block of a child arena, see Arena_init_child.
+ */
+typedef struct arena_child_header_t {
+    GrowableArena *parent;
+    GrowableArenaMark mark;     // The parent before the block was allocated
+    GrowableArenaMark top;      // The parent right after
+} ArenaChildHeader;
+
+#define ARENA_CHILD_HEADER_SIZE \
+    ((sizeof(ArenaChildHeader) + ARENA_DEFAULT_ALIGNMENT - 1) & ~(ARENA_DEFAULT_ALIGNMENT - 1))
+
+/**
+ * ArenaAllocator callbacks of child arenas. Blocks are only handed out by Arena_init_child, free
+ * rewinds the parent if nothing was allocated from it after the child.
+ */
+static void *Arena_child_alloc(void *context, size_t size) {
+    (void)context;
+    (void)size;
+    return NULL;
+}
+
+static void Arena_child_free(void *context, void *ptr, size_t size) {
+    (void)context;
+    (void)size;
+    const ArenaChildHeader *header = (const ArenaChildHeader *)((char *)ptr - ARENA_CHILD_HEADER_SIZE);
+    GrowableArena *parent = header->parent;
+    const GrowableArenaMark top = GrowableArena_mark(parent);
+    if (top.page == header->top.page && top.page_mark.offset == header->top.page_mark.offset &&
+        top.large_blocks == header->top.large_blocks) {
+        GrowableArena_rewind(parent, header->mark);
+    }
+}
+
+static const ArenaAllocator Arena_child_allocator = {
+    .alloc = Arena_child_alloc,
+    .free = Arena_child_free,
+    .context = NULL,
+};
+
+/**
+ * Initialize an arena on a block carved from a growable arena, for a sub-task that discards its
+ * memory as a whole. Arena_free hands the block back by rewinding the parent, if nothing was
+ * allocated from the parent after the child, so lifetimes can nest: a request arena, a stage
+ * child, a temporary child of the next level, each torn down in constant time. Otherwise the block
+ * stays until the parent is reset or rewound. The child must not be used after its parent is
+ * reset or rewound past it.
+ * @param child An empty arena struct
+ * @param parent The growable arena to carve the block from
+ * @param capacity No. of bytes of the child
+ * @return true for success, false if allocation failed
+ */
+bool Arena_init_child(Arena *child, GrowableArena *parent, const size_t capacity) {
+    if (child == NULL || parent == NULL || capacity > SIZE_MAX - ARENA_CHILD_HEADER_SIZE) return false;
+    const GrowableArenaMark mark = GrowableArena_mark(parent);
+    char *block = GrowableArena_alloc_aligned(parent, ARENA_CHILD_HEADER_SIZE + capacity, ARENA_DEFAULT_ALIGNMENT);
+    if (block == NULL) return false;
+
+    ArenaChildHeader *header = (ArenaChildHeader *)block;
+    header->parent = parent;
+    header->mark = mark;
+    header->top = GrowableArena_mark(parent);
+    Arena_init_block(child, block + ARENA_CHILD_HEADER_SIZE, capacity, &Arena_child_allocator);
+    return true;
+}
+
+#ifdef ARENA_STATS
+/**
+ * Take a snapshot of the allocation statistics of the growable arena in constant time. Pages the
+ * arena moved on from count as used up to their end.
+ * @param arena The growable arena
+ * @return The statistics, all zero for NULL
+ */
+ArenaStats GrowableArena_stats(const GrowableArena *arena) {
+    ArenaStats stats = {0};
+    if (arena == NULL || arena->current == NULL) return stats;
+    const Arena *page = &arena->current->arena;
+    stats = arena->stats;
+    stats.requested += page->requested;
+    stats.used += page->next_offset;
+    stats.allocations += page->allocations;
+    if (stats.used > stats.peak) stats.peak = stats.used;
+    stats.pages = arena->pages;
+    stats.large_blocks = arena->large_blocks;
+    stats.fragmentation = ArenaStats_fragmentation(&stats);
+    return stats;
+}
+#endif
+
+#ifdef ARENA_HAS_MMAP
+/**
+ * Open a regular file for reading.
+ * @param path Path of the file
+ * @param size Receives the size of the file
+ * @return The file descriptor or -1 if the file cannot be opened or is not a regular file
+ */
+static int Arena_open_file(const char *path, size_t *size) {
+    if (path == NULL) return -1;
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uintmax_t)st.st_size >= SIZE_MAX) {
+        close(fd);
+        return -1;
+    }
+    *size = (size_t)st.st_size;
+    return fd;
+}
+
+/**
+ * Read a file into a buffer of size + 1 bytes and NUL terminate it.
+ * @param fd The file descriptor
+ * @param data The buffer
+ * @param size No. of bytes to read, receives the no. of bytes read if the file got shorter
+ * @return true for success, false if reading failed
+ */
+static bool Arena_read_fd(const int fd, char *data, size_t *size) {
+    size_t done = 0;
+    while (done < *size) {
+        const ssize_t count = read(fd, data + done, *size - done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return false;
+        if (count == 0) break;
+        done += (size_t)count;
+    }
+    data[done] = '\0';
+    *size = done;
+    return true;
+}
+
+/**
+ * Map a file read-only.
+ * @param fd The file descriptor
+ * @param size Size of the file, not 0
+ * @return The mapping or NULL if mapping failed
+ */
+static void *Arena_mmap_file(const int fd, const size_t size) {
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) return NULL;
+#ifdef MADV_SEQUENTIAL
+    madvise(data, size, MADV_SEQUENTIAL);
+#endif
+    return data;
+}
+
+/**
+ * Read a whole file into an aligned block of the arena. The contents are NUL terminated, so text
+ * parsers can slice them in place.
+ * @param arena The arena
+ * @param path Path of the file
+ * @param alignment Alignment of the block, a power of two
+ * @param size Receives the size of the file without the terminator, may be NULL
+ * @return The contents or NULL if the file cannot be read or does not fit, the arena is left as it was
+ */
+void *Arena_read_file(Arena *arena, const char *path, const size_t alignment, size_t *size) {
+    if (arena == NULL) return NULL;
+    size_t length;
+    const int fd = Arena_open_file(path, &length);
+    if (fd < 0) return NULL;
+
+    const ArenaMark mark = Arena_mark(arena);
+    const size_t capacity = length;
+    char *data = Arena_alloc_aligned(arena, capacity + 1, alignment);
+    const bool read = data != NULL && Arena_read_fd(fd, data, &length);
+    close(fd);
+    if (!read) {
+        Arena_rewind(arena, mark);
+        return NULL;
+    }
+    if (length < capacity) Arena_resize_last(arena, data, capacity + 1, length + 1);
+    if (size != NULL) *size = length;
+    return data;
+}
+
+/**
+ * Map a whole file read-only. The mapping is owned by the arena: it is unmapped by Arena_reset,
+ * Arena_free and by rewinding to a mark taken before it. The contents are not NUL terminated.
+ * @param arena The arena, holds a small record of the mapping
+ * @param path Path of the file
+ * @param size Receives the size of the file, may be NULL
+ * @return The contents or NULL if the file cannot be mapped, an empty file maps to ""
+ */
+const void *Arena_map_file(Arena *arena, const char *path, size_t *size) {
+    if (arena == NULL) return NULL;
+    size_t length;
+    const int fd = Arena_open_file(path, &length);
+    if (fd < 0) return NULL;
+    if (length == 0) {
+        close(fd);
+        if (size != NULL) *size = 0;
+        return "";
+    }
+
+    const ArenaMark mark = Arena_mark(arena);
+    ArenaMapping *mapping = Arena_alloc_aligned(arena, sizeof(ArenaMapping), alignof(ArenaMapping));
+    void *data = mapping != NULL ? Arena_mmap_file(fd, length) : NULL;
+    close(fd);
+    if (data == NULL) {
+        Arena_rewind(arena, mark);
+        return NULL;
+    }
+    *mapping = (ArenaMapping){ .next = arena->mappings, .data = data, .size = length };
+    arena->mappings = mapping;
+    if (size != NULL) *size = length;
+    return data;
+}
+
+/**
+ * Read a whole file into an aligned block of the growable arena, see Arena_read_file. Files bigger
+ * than a page get a large block.
+ * @param arena The growable arena
+ * @param path Path of the file
+ * @param alignment Alignment of the block, a power of two
+ * @param size Receives the size of the file without the terminator, may be NULL
+ * @return The contents or NULL if the file cannot be read, the arena is left as it was
+ */
+void *GrowableArena_read_file(GrowableArena *arena, const char *path, const size_t alignment, size_t *size) {
+    if (arena == NULL) return NULL;
+    size_t length;
+    const int fd = Arena_open_file(path, &length);
+    if (fd < 0) return NULL;
+
+    const GrowableArenaMark mark = GrowableArena_mark(arena);
+    char *data = GrowableArena_alloc_aligned(arena, length + 1, alignment);
+    const bool read = data != NULL && Arena_read_fd(fd, data, &length);
+    close(fd);
+    if (!read) {
+        GrowableArena_rewind(arena, mark);
+        return NULL;
+    }
+    if (size != NULL) *size = length;
+    return data;
+}
+
+/**
+ * Map a whole file read-only, see Arena_map_file. The mapping is unmapped by GrowableArena_reset,
+ * GrowableArena_free and by rewinding to a mark taken before it.
+ * @param arena The growable arena, holds a small record of the mapping
+ * @param path Path of the file
+ * @param size Receives the size of the file, may be NULL
+ * @return The contents or NULL if the file cannot be mapped, an empty file maps to ""
+ */
+const void *GrowableArena_map_file(GrowableArena *arena, const char *path, size_t *size) {
+    if (arena == NULL) return NULL;
+    size_t length;
+    const int fd = Arena_open_file(path, &length);
+    if (fd < 0) return NULL;
+    if (length == 0) {
+        close(fd);
+        if (size != NULL) *size = 0;
+        return "";
+    }
+
+    const GrowableArenaMark mark = GrowableArena_mark(arena);
+    ArenaMapping *mapping = GrowableArena_alloc_aligned(arena, sizeof(ArenaMapping), alignof(ArenaMapping));
+    void *data = mapping != NULL ? Arena_mmap_file(fd, length) : NULL;
+    close(fd);
+    if (data == NULL) {
+        GrowableArena_rewind(arena, mark);
+        return NULL;
+    }
+    *mapping = (ArenaMapping){ .next = arena->mappings, .data = data, .size = length };
+    arena->mappings = mapping;
+    if (size != NULL) *size = length;
+    return data;
+}
+
+/**
+ * Fault in the pages of a range of memory ahead of use, so the first touch does not take a page
+ * fault. Uses MADV_POPULATE_WRITE where the kernel has it, otherwise writes to every page.
+ * @param data Start of the range, page aligned
+ * @param size Size of the range
+ */
+static void Arena_populate(void *data, const size_t size) {
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(data, size, MADV_POPULATE_WRITE) == 0) return;
+#endif
+    const long os_page_size = sysconf(_SC_PAGESIZE);
+    const size_t page_size = os_page_size > 0 ? (size_t)os_page_size : 4096;
+    volatile char *bytes = data;
+    for (size_t i = 0; i < size; i += page_size) {
+        // The contents are undefined anyway, keep a memory checker from seeing the write
+        ARENA_UNPOISON((char *)data + i, 1);
+        bytes[i] = 0;
+        ARENA_POISON((char *)data + i, 1);
+    }
+}
+
+/**
+ * Flags for ArenaAllocator_prefault.
+ */
+enum {
+    ARENA_PREFAULT = 1 << 0,    // Fault in all pages when the memory is allocated
+    ARENA_LOCK = 1 << 1,        // Pin the memory with mlock, allocation fails if it cannot be locked
+};
+
+/**
+ * ArenaAllocator callbacks of ArenaAllocator_prefault, blocks are mapped with mmap.
+ */
+static size_t Arena_prefault_size(const size_t size) {
+    const long os_page_size = sysconf(_SC_PAGESIZE);
+    const size_t page_size = os_page_size > 0 ? (size_t)os_page_size : 4096;
+    return size > SIZE_MAX - page_size ? 0 : (size + page_size - 1) & ~(page_size - 1);
+}
+
+static void *Arena_prefault_alloc(void *context, size_t size) {
+    const unsigned flags = (unsigned)(uintptr_t)context;
+    const size_t mapped = Arena_prefault_size(size);
+    if (mapped == 0) return NULL;
+
+    int map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+    if (flags & (ARENA_PREFAULT | ARENA_LOCK)) map_flags |= MAP_POPULATE;
+#endif
+    void *data = mmap(NULL, mapped, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+    if (data == MAP_FAILED) return NULL;
+#ifndef MAP_POPULATE
+    if (flags & ARENA_PREFAULT) Arena_populate(data, mapped);
+#endif
+    if ((flags & ARENA_LOCK) && mlock(data, mapped) != 0) {
+        munmap(data, mapped);
+        return NULL;
+    }
+    return data;
+}
+
+static void Arena_prefault_free(void *context, void *ptr, size_t size) {
+    (void)context;
+    // Unmapping drops the lock as well
+    munmap(ptr, Arena_prefault_size(size));
+}
+
+/**
+ * A backing allocator that maps memory with its pages faulted in, and optionally locked, up front.
+ * Pass it to Arena_init_with_allocator or GrowableArenaOptions.allocator, so neither the arena
+ * block nor new pages take first-touch page faults on the critical path. Blocks are rounded up to
+ * whole OS pages, use it for pages of at least a few KiB.
+ * @param flags ARENA_PREFAULT, ARENA_LOCK or both
+ * @return The allocator, must outlive the arenas using it
+ */
+ArenaAllocator ArenaAllocator_prefault(const unsigned flags) {
+    return (ArenaAllocator){
+        .alloc = Arena_prefault_alloc,
+        .free = Arena_prefault_free,
+        .context = (void *)(uintptr_t)flags,
+    };
+}
+
+/**
+ * Granularity in which a virtual arena commits memory.
+ */
+#define VIRTUAL_ARENA_COMMIT_SIZE (64 * 1024)
+
+/**
+ * Size of a huge page, used as commit granularity with VIRTUAL_ARENA_HUGE_PAGES.
+ */
+#define VIRTUAL_ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * Flags for VirtualArena_init.
+ */
+enum {
+    VIRTUAL_ARENA_DECOMMIT_ON_RESET = 1 << 0,   // Return committed memory to the OS on reset
+    VIRTUAL_ARENA_HUGE_PAGES = 1 << 1,          // Back the arena with 2 MiB huge pages if possible
+    VIRTUAL_ARENA_PREFAULT = 1 << 2,            // Fault in memory as it is committed, see Arena_populate
+};
+
+/**
+ * The kind of memory backing a virtual arena actually got.
+ */
+typedef enum arena_backing_t {
+    ARENA_BACKING_PAGES,        // Regular OS pages
+    ARENA_BACKING_THP,          // Transparent huge pages, requested with madvise(MADV_HUGEPAGE)
+    ARENA_BACKING_HUGETLB,      // Explicit huge pages from the hugetlb pool (MAP_HUGETLB)
+} ArenaBacking;
+
+/**
+ * Virtual memory arena allocator.
+ *
+ * Reserves a large range of address space up front and commits memory in VIRTUAL_ARENA_COMMIT_SIZE
+ * steps as the arena fills up. Allocations never move, growing never copies and there is no page
+ * list to maintain. Only committed memory counts towards RSS, so the reservation can be generous.
+ *
+ * With VIRTUAL_ARENA_HUGE_PAGES the arena first asks for explicit huge pages (MAP_HUGETLB), which
+ * takes the whole reservation from the hugetlb pool up front. If the pool is too small it falls back
+ * to transparent huge pages and finally to regular pages. The backing field reports the result.
+ */
+typedef struct virtual_arena_t {
+    void * data;
+    size_t reserved;
+    size_t committed;
+    size_t next_offset;
+    size_t commit_size;
+    unsigned flags;
+    ArenaBacking backing;
+} VirtualArena;
+
+/**
+ * Rounds a size up to a multiple of a power of two.
+ */
+static inline size_t VirtualArena_round_up(const size_t size, const size_t multiple) {
+    return (size + multiple - 1) & ~(multiple - 1);
+}
+
+#ifdef MADV_HUGEPAGE
+/**
+ * Checks whether transparent huge pages can be used with madvise.
+ * @return false if the kernel has transparent huge pages disabled
+ */
+static bool VirtualArena_thp_enabled(void) {
+#ifdef __linux__
+    FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (file == NULL) return false;
+    char mode[64] = {0};
+    const bool read = fgets(mode, sizeof(mode), file) != NULL;
+    fclose(file);
+    return read && strstr(mode, "[never]") == NULL;
+#else
+    return false;
+#endif
+}
+#endif
+
+/**
+ * Reserve address space aligned to a huge page and ask for transparent huge pages.
+ * @param reserved No. of bytes to reserve, a multiple of VIRTUAL_ARENA_HUGE_PAGE_SIZE
+ * @param map_flags Flags for mmap
+ * @param backing Receives the backing of the reservation
+ * @return The reservation or MAP_FAILED
+ */
+static void *VirtualArena_reserve_thp(const size_t reserved, const int map_flags, ArenaBacking *backing) {
+    // Over-reserve so the start can be aligned to a huge page, then trim the excess
+    const size_t slack = VIRTUAL_ARENA_HUGE_PAGE_SIZE;
+    char *raw = mmap(NULL, reserved + slack, PROT_NONE, map_flags, -1, 0);
+    if (raw == MAP_FAILED) return MAP_FAILED;
+
+    char *data = (char *)VirtualArena_round_up((uintptr_t)raw, VIRTUAL_ARENA_HUGE_PAGE_SIZE);
+    if (data > raw) munmap(raw, (size_t)(data - raw));
+    if (data + reserved < raw + reserved + slack)
+        munmap(data + reserved, (size_t)(raw + reserved + slack - (data + reserved)));
+
+    *backing = ARENA_BACKING_PAGES;
+#ifdef MADV_HUGEPAGE
+    if (VirtualArena_thp_enabled() && madvise(data, reserved, MADV_HUGEPAGE) == 0)
+        *backing = ARENA_BACKING_THP;
+#endif
+    return data;
+}
+
+/**
+ * Initialize a virtual arena. No memory is committed yet.
+ * @param arena An empty VirtualArena struct
+ * @param reserve No. of bytes of address space to reserve
+ * @param flags VIRTUAL_ARENA_* flags or 0
+ * @return true for success, false if the reservation failed
+ */
+bool VirtualArena_init(VirtualArena *arena, const size_t reserve, const unsigned flags) {
+    if (arena == NULL || reserve == 0) return false;
+
+    const long os_page_size = sysconf(_SC_PAGESIZE);
+    const size_t page_size = os_page_size > 0 ? (size_t)os_page_size : 4096;
+    const size_t commit_size = (flags & VIRTUAL_ARENA_HUGE_PAGES)
+        ? VirtualArena_round_up(VIRTUAL_ARENA_HUGE_PAGE_SIZE, page_size)
+        : VirtualArena_round_up(VIRTUAL_ARENA_COMMIT_SIZE, page_size);
+    if (reserve > SIZE_MAX - 2 * commit_size) return false;
+    const size_t reserved = VirtualArena_round_up(reserve, commit_size);
+
+    int map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *data = MAP_FAILED;
+    ArenaBacking backing = ARENA_BACKING_PAGES;
+
+    if (flags & VIRTUAL_ARENA_HUGE_PAGES) {
+#ifdef MAP_HUGETLB
+        // Without MAP_NORESERVE the hugetlb pool must cover the reservation, or mmap fails right away
+        data = mmap(NULL, reserved, PROT_NONE, map_flags | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) backing = ARENA_BACKING_HUGETLB;
+#endif
+    }
+
+#ifdef MAP_NORESERVE
+    map_flags |= MAP_NORESERVE;
+#endif
+    if (data == MAP_FAILED && (flags & VIRTUAL_ARENA_HUGE_PAGES))
+        data = VirtualArena_reserve_thp(reserved, map_flags, &backing);
+    if (data == MAP_FAILED)
+        data = mmap(NULL, reserved, PROT_NONE, map_flags, -1, 0);
+    if (data == MAP_FAILED) return false;
+
+    arena->data = data;
+    arena->reserved = reserved;
+    arena->committed = 0;
+    arena->next_offset = 0;
+    arena->commit_size = commit_size;
+    arena->flags = flags;
+    arena->backing = backing;
+    return true;
+}
+
+/**
+ * Returns the kind of memory backing the arena, which may differ from the requested one.
+ * @param arena The virtual arena
+ * @return The backing of the arena
+ */
+ArenaBacking VirtualArena_backing(const VirtualArena *arena) {
+    if (arena == NULL) return ARENA_BACKING_PAGES;
+    return arena->backing;
+}
+
+/**
+ * Returns a printable name of a backing.
+ * @param backing The backing
+ * @return Name of the backing
+ */
+const char *ArenaBacking_name(const ArenaBacking backing) {
+    switch (backing) {
+        case ARENA_BACKING_PAGES: return "pages";
+        case ARENA_BACKING_THP: return "thp";
+        case ARENA_BACKING_HUGETLB: return "hugetlb";
+    }
+    return "unknown";
+}
+
+/**
+ * Make sure the first end bytes of the arena are committed.
+ * @param arena The virtual arena
+ * @param end No. of bytes from the start of the reservation
+ * @return true for success, false if end is beyond the reservation or the commit failed
+ */
+static ARENA_COLD bool VirtualArena_commit_slow(VirtualArena *arena, const size_t end) {
+    if (end > arena->reserved) return false;
+
+    size_t committed = VirtualArena_round_up(end, arena->commit_size);
+    if (committed > arena->reserved) committed = arena->reserved;
+    if (mprotect((char *)arena->data + arena->committed, committed - arena->committed,
+                 PROT_READ | PROT_WRITE) != 0)
+        return false;
+    if (arena->flags & VIRTUAL_ARENA_PREFAULT)
+        Arena_populate((char *)arena->data + arena->committed, committed - arena->committed);
+
+    arena->committed = committed;
+    return true;
+}
+
+/**
+ * Make sure the first end bytes of the arena are committed, without a call if they already are.
+ */
+static inline bool VirtualArena_commit(VirtualArena *arena, const size_t end) {
+    if (ARENA_LIKELY(end <= arena->committed)) return true;
+    return VirtualArena_commit_slow(arena, end);
+}
+
+/**
+ * Allocate aligned memory from the virtual arena.
+ * @param arena The virtual arena
+ * @param size No. of bytes to allocate
+ * @param alignment Alignment of the memory block, a power of two up to ARENA_MAX_ALIGNMENT
+ * @return Pointer to the memory block or NULL if the reservation is exhausted
+ */
+static inline void *VirtualArena_alloc_aligned(VirtualArena *arena, const size_t size, const size_t alignment) {
+    ARENA_CHECK(arena != NULL, NULL);
+    if (!Arena_valid_alignment(alignment)) return NULL;
+    const uintptr_t base = (uintptr_t)arena->data;
+    const uintptr_t address = (base + arena->next_offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    const size_t offset = address - base;
+    if (offset > arena->reserved || size > arena->reserved - offset) return NULL;
+    if (!VirtualArena_commit(arena, offset + size)) return NULL;
+    arena->next_offset = offset + size;
+    ARENA_UNPOISON((char *)arena->data + offset, size);
+    return (char *)arena->data + offset;
+}
+
+/**
+ * Allocate a contiguous array of objects from the virtual arena.
+ * @param arena The virtual arena
+ * @param count No. of objects
+ * @param size Size of a single object in bytes, a multiple of alignment keeps every object aligned
+ * @param alignment Alignment of the array, a power of two up to ARENA_MAX_ALIGNMENT
+ * @return Pointer to the first object or NULL if the reservation is exhausted
+ */
+void *VirtualArena_alloc_array(VirtualArena *arena, const size_t count, const size_t size, const size_t alignment) {
+    if (size != 0 && count > SIZE_MAX / size) return NULL;
+    return VirtualArena_alloc_aligned(arena, count * size, alignment);
+}
+
+/**
+ * Allocate memory from the virtual arena. The memory is aligned like Arena_alloc.
+ * @param arena The virtual arena
+ * @param size No. of bytes to allocate
+ * @return Pointer to the memory block or NULL if the reservation is exhausted
+ */
+static inline void *VirtualArena_alloc(VirtualArena *arena, const size_t size) {
+#ifdef ARENA_ALIGN_BY_DEFAULT
+    return VirtualArena_alloc_aligned(arena, size, ARENA_DEFAULT_ALIGNMENT);
+#else
+    ARENA_CHECK(arena != NULL, NULL);
+    if (size > arena->reserved - arena->next_offset) return NULL;
+    const size_t offset = arena->next_offset;
+    if (!VirtualArena_commit(arena, offset + size)) return NULL;
+    arena->next_offset = offset + size;
+    ARENA_UNPOISON((char *)arena->data + offset, size);
+    return (char *)arena->data + offset;
+#endif
+}
+
+/**
+ * Resize a memory block of the virtual arena. The most recent allocation is grown or shrunk in
+ * place, committing more memory as needed. Otherwise a new block aligned to ARENA_DEFAULT_ALIGNMENT
+ * is allocated and the contents are copied.
+ * @param arena The virtual arena
+ * @param ptr The memory block or NULL to allocate a new one
+ * @param old_size Current size of the memory block
+ * @param new_size Requested size of the memory block
+ * @return Pointer to the memory block or NULL if the reservation is exhausted
+ */
+void *VirtualArena_realloc(VirtualArena *arena, void *ptr, const size_t old_size, const size_t new_size) {
+    if (arena == NULL) return NULL;
+    if (ptr == NULL) return VirtualArena_alloc_aligned(arena, new_size, ARENA_DEFAULT_ALIGNMENT);
+
+    const char *data = arena->data;
+    if ((const char *)ptr >= data && (const char *)ptr + old_size == data + arena->next_offset) {
+        const size_t offset = (size_t)((const char *)ptr - data);
+        if (new_size <= arena->reserved - offset && VirtualArena_commit(arena, offset + new_size)) {
+            if (new_size > old_size) ARENA_UNPOISON((char *)ptr + old_size, new_size - old_size);
+            else ARENA_POISON((char *)ptr + new_size, old_size - new_size);
+            arena->next_offset = offset + new_size;
+            return ptr;
+        }
+    }
+
+    void *mem = VirtualArena_alloc_aligned(arena, new_size, ARENA_DEFAULT_ALIGNMENT);
+    if (mem == NULL) return NULL;
+    memcpy(mem, ptr, old_size < new_size ? old_size : new_size);
+    return mem;
+}
+
+/**
+ * Resets the virtual arena, meaning the reservation is fully available. With
+ * VIRTUAL_ARENA_DECOMMIT_ON_RESET the committed memory beyond the first commit step is handed back
+ * to the OS, it reads as zero when it is touched again.
+ * @param arena The virtual arena to reset
+ */
+void VirtualArena_reset(VirtualArena *arena) {
+    if (arena == NULL) return;
+#ifdef ARENA_DEBUG
+    memset(arena->data, ARENA_POISON_BYTE, arena->next_offset);
+#endif
+    ARENA_POISON(arena->data, arena->next_offset);
+    arena->next_offset = 0;
+
+#ifdef MADV_DONTNEED
+    if ((arena->flags & VIRTUAL_ARENA_DECOMMIT_ON_RESET) && arena->committed > arena->commit_size)
+        madvise((char *)arena->data + arena->commit_size, arena->committed - arena->commit_size,
+                MADV_DONTNEED);
+#endif
+}
+
+/**
+ * Capture the current fill level of the virtual arena.
+ * @param arena The virtual arena
+ * @return A mark to pass to VirtualArena_rewind
+ */
+ArenaMark VirtualArena_mark(const VirtualArena *arena) {
+    const ArenaMark mark = { .offset = arena != NULL ? arena->next_offset : 0 };
+    return mark;
+}
+
+/**
+ * Release all memory allocated after the mark was taken. The memory stays committed.
+ * @param arena The virtual arena
+ * @param mark A mark returned by VirtualArena_mark
+ */
+void VirtualArena_rewind(VirtualArena *arena, const ArenaMark mark) {
+    if (arena == NULL || mark.offset > arena->next_offset) return;
+#ifdef ARENA_DEBUG
+    memset((char *)arena->data + mark.offset, ARENA_POISON_BYTE, arena->next_offset - mark.offset);
+#endif
+    ARENA_POISON((char *)arena->data + mark.offset, arena->next_offset - mark.offset);
+    arena->next_offset = mark.offset;
+}
+
+/**
+ * Release the address space reserved by the arena. After this call, the arena cannot be used
+ * anymore.
+ * @param arena The arena to free.
+ */
+void VirtualArena_free(VirtualArena *arena) {
+    if (arena != NULL && arena->data != NULL) {
+        // Shadow memory outlives the mapping
+        ARENA_UNPOISON(arena->data, arena->committed);
+        munmap(arena->data, arena->reserved);
+        arena->data = NULL;
+        arena->committed = 0;
+    }
+}
+
+/**
+ * Returns the amount of available bytes left for allocation.
+ * @param arena
+ * @return Number of bytes available in the reservation.
+ */
+size_t VirtualArena_remaining(const VirtualArena *arena) {
+    if (arena == NULL) return 0;
+    return arena->reserved - arena->next_offset;
+}
+
+/**
+ * Size of the snapshot file header. The data follows at this offset plus the residue of its
+ * address, so a page aligned mapping puts every byte at the same address modulo
+ * ARENA_MAX_ALIGNMENT as in the saved arena and aligned allocations stay aligned.
+ */
+#define ARENA_SNAPSHOT_HEADER_SIZE ARENA_MAX_ALIGNMENT
+
+#define ARENA_SNAPSHOT_VERSION 1
+
+/**
+ * Header of a snapshot file.
+ */
+typedef struct arena_snapshot_header_t {
+    char magic[8];          // "ARENASNP"
+    uint32_t version;       // ARENA_SNAPSHOT_VERSION
+    uint32_t byte_order;    // 0x01020304 in the byte order of the writer
+    uint32_t pointer_size;  // sizeof(void *) of the writer
+    uint32_t reserved;
+    uint64_t size;          // No. of data bytes
+    uint64_t residue;       // Address of the data modulo ARENA_MAX_ALIGNMENT
+    uint64_t root;          // Offset of the root object or ARENA_NULL_OFFSET
+} ArenaSnapshotHeader;
+
+/**
+ * Write a whole buffer to a file descriptor.
+ * @return true for success, false if writing failed
+ */
+static bool Arena_write_fd(const int fd, const char *data, size_t size) {
+    while (size > 0) {
+        const ssize_t count = write(fd, data, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        data += count;
+        size -= (size_t)count;
+    }
+    return true;
+}
+
+/**
+ * Write arena data, including allocation overhead. Red zones are poisoned under a memory
+ * checker, AddressSanitizer gets a copy with them zeroed, Valgrind does not report them.
+ * @return true for success, false if writing failed
+ */
+static bool Arena_write_data(const int fd, const char *data, const size_t size) {
+#if defined(ARENA_ASAN)
+    char buffer[4096];
+    for (size_t done = 0; done < size; done += sizeof(buffer)) {
+        const size_t count = size - done < sizeof(buffer) ? size - done : sizeof(buffer);
+        for (size_t i = 0; i < count; ++i)
+            buffer[i] = __asan_address_is_poisoned(data + done + i) ? 0 : data[done + i];
+        if (!Arena_write_fd(fd, buffer, count)) return false;
+    }
+    return true;
+#elif defined(ARENA_VALGRIND)
+    VALGRIND_DISABLE_ERROR_REPORTING;
+    const bool written = Arena_write_fd(fd, data, size);
+    VALGRIND_ENABLE_ERROR_REPORTING;
+    return written;
+#else
+    return Arena_write_fd(fd, data, size);
+#endif
+}
+
+/**
+ * Save a contiguous block of arena data to a snapshot file.
+ * @param data Start of the arena data
+ * @param size No. of bytes in use
+ * @param path Path of the file, replaced if it exists
+ * @param root Offset of the root object or ARENA_NULL_OFFSET
+ * @return true for success, false if writing failed
+ */
+static bool Arena_save_data(const void *data, const size_t size, const char *path, const size_t root) {
+    if (path == NULL || (root != ARENA_NULL_OFFSET && root >= size)) return false;
+    const size_t residue = (uintptr_t)data % ARENA_MAX_ALIGNMENT;
+    char header[ARENA_SNAPSHOT_HEADER_SIZE + ARENA_MAX_ALIGNMENT] = {0};
+    const ArenaSnapshotHeader fields = {
+        .magic = "ARENASNP",
+        .version = ARENA_SNAPSHOT_VERSION,
+        .byte_order = 0x01020304,
+        .pointer_size = sizeof(void *),
+        .size = size,
+        .residue = residue,
+        .root = root == ARENA_NULL_OFFSET ? UINT64_MAX : root,
+    };
+    memcpy(header, &fields, sizeof(fields));
+
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool saved = Arena_write_fd(fd, header, ARENA_SNAPSHOT_HEADER_SIZE + residue) && Arena_write_data(fd, data, size);
+    saved = close(fd) == 0 && saved;
+    if (!saved) unlink(path);
+    return saved;
+}
+
+/**
+ * Save the memory allocated from an arena to a file, to be mapped back with ArenaSnapshot_load.
+ * Link the saved data with offsets or ArenaRelPtr, absolute pointers do not survive the load.
+ * @param arena The arena
+ * @param path Path of the file, replaced if it exists
+ * @param root The object to find the data from after loading, in the arena, or NULL
+ * @return true for success, false if root is not in the arena or writing failed
+ */
+bool Arena_save(const Arena *arena, const char *path, const void *root) {
+    if (arena == NULL || arena->data == NULL) return false;
+    const size_t offset = Arena_offset(arena, root);
+    if (root != NULL && offset == ARENA_NULL_OFFSET) return false;
+    return Arena_save_data(arena->data, arena->next_offset, path, offset);
+}
+
+/**
+ * Save the memory allocated from a virtual arena to a file, see Arena_save.
+ * @param arena The virtual arena
+ * @param path Path of the file, replaced if it exists
+ * @param root The object to find the data from after loading, in the arena, or NULL
+ * @return true for success, false if root is not in the arena or writing failed
+ */
+bool VirtualArena_save(const VirtualArena *arena, const char *path, const void *root) {
+    if (arena == NULL || arena->data == NULL) return false;
+    const uintptr_t address = (uintptr_t)root, data = (uintptr_t)arena->data;
+    if (root != NULL && (address < data || address - data >= arena->next_offset)) return false;
+    return Arena_save_data(arena->data, arena->next_offset, path, root != NULL ? (size_t)(address - data) : ARENA_NULL_OFFSET);
+}
+
+/**
+ * Arena data mapped back from a snapshot file. The mapping is private and read-only, loading
+ * costs one mmap, pages are read on first touch.
+ */
+typedef struct arena_snapshot_t {
+    void *mapping;
+    size_t mapping_size;
+    const void *data;       // The saved data, at the same address modulo ARENA_MAX_ALIGNMENT
+    size_t size;            // No. of data bytes
+    size_t root;            // Offset of the root object or ARENA_NULL_OFFSET
+} ArenaSnapshot;
+
+/**
+ * Map a snapshot file saved with Arena_save or VirtualArena_save.
+ * @param snapshot An empty ArenaSnapshot struct
+ * @param path Path of the file
+ * @return true for success, false if the file cannot be mapped or was not written by a compatible build
+ */
+bool ArenaSnapshot_load(ArenaSnapshot *snapshot, const char *path) {
+    if (snapshot == NULL) return false;
+    size_t length;
+    const int fd = Arena_open_file(path, &length);
+    if (fd < 0) return false;
+    if (length < ARENA_SNAPSHOT_HEADER_SIZE) {
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    ArenaSnapshotHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    if (memcmp(header.magic, "ARENASNP", 8) != 0 || header.version != ARENA_SNAPSHOT_VERSION ||
+        header.byte_order != 0x01020304 || header.pointer_size != sizeof(void *) ||
+        header.residue >= ARENA_MAX_ALIGNMENT || header.residue > length - ARENA_SNAPSHOT_HEADER_SIZE ||
+        header.size > length - ARENA_SNAPSHOT_HEADER_SIZE - header.residue ||
+        (header.root != UINT64_MAX && header.root >= header.size)) {
+        munmap(mapping, length);
+        return false;
+    }
+
+    snapshot->mapping = mapping;
+    snapshot->mapping_size = length;
+    snapshot->data = (const char *)mapping + ARENA_SNAPSHOT_HEADER_SIZE + header.residue;
+    snapshot->size = (size_t)header.size;
+    snapshot->root = header.root == UINT64_MAX ? ARENA_NULL_OFFSET : (size_t)header.root;
+    return true;
+}
+
+/**
+ * Memory of a snapshot at an offset of the saved arena, see Arena_offset.
+ * @param snapshot The snapshot
+ * @param offset The offset
+ * @return Pointer to the memory or NULL for ARENA_NULL_OFFSET or an offset outside the data
+ */
+static inline const void *ArenaSnapshot_at(const ArenaSnapshot *snapshot, const size_t offset) {
+    if (snapshot == NULL || offset >= snapshot->size) return NULL;
+    return (const char *)snapshot->data + offset;
+}
+
+/**
+ * The root object passed to Arena_save.
+ * @param snapshot The snapshot
+ * @return The root object or NULL if none was saved
+ */
+static inline const void *ArenaSnapshot_root(const ArenaSnapshot *snapshot) {
+    return snapshot != NULL ? ArenaSnapshot_at(snapshot, snapshot->root) : NULL;
+}
+
+/**
+ * Unmap a snapshot. Pointers into the snapshot become invalid.
+ * @param snapshot The snapshot
+ */
+void ArenaSnapshot_free(ArenaSnapshot *snapshot) {
+    if (snapshot != NULL && snapshot->mapping != NULL) {
+        munmap(snapshot->mapping, snapshot->mapping_size);
+        snapshot->mapping = NULL;
+        snapshot->data = NULL;
+        snapshot->size = 0;
+    }
+}
+
+#endif
+
+#ifdef ARENA_TRACE
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "ARENA_TRACE needs the statement expressions of GCC or Clang"
+#endif
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * Allocation tracing. Define ARENA_TRACE to route Arena_alloc, Arena_alloc_aligned,
+ * GrowableArena_alloc and GrowableArena_alloc_aligned through macros that record the callsite.
+ * Every callsite owns a static ArenaTraceSite with counters, registered on its first call, and
+ * every allocation is written to a ring buffer of the most recent events, shared by all threads.
+ * Recording costs a few relaxed atomic adds, a compare and swap on the ring slot and a cycle
+ * counter read, so it can stay on in canaries. An event is dropped if its slot is still being
+ * written by a thread a full ring behind.
+ *
+ * The macros are defined at the end of arena.c, so calls inside the other files of the library
+ * are recorded at their callsite there.
+ */
+#ifndef ARENA_TRACE_RING_SIZE
+#define ARENA_TRACE_RING_SIZE 4096  // No. of recent events kept, a power of two
+#endif
+
+/**
+ * Counters of an allocation callsite.
+ */
+typedef struct arena_trace_site_t {
+    const char *file;
+    unsigned line;
+    const char *function;           // The traced allocation function
+    atomic_size_t count;            // No. of calls
+    atomic_size_t bytes;            // Bytes requested
+    atomic_size_t failures;         // No. of calls that returned NULL
+    atomic_int state;               // 0 unregistered, 1 registering, 2 registered
+    struct arena_trace_site_t *next;
+} ArenaTraceSite;
+
+/**
+ * A recorded allocation.
+ */
+typedef struct arena_trace_event_t {
+    const ArenaTraceSite *site;
+    const void *arena;
+    size_t size;
+    uint64_t time;                  // ArenaTrace_now, only comparable within one boot
+} ArenaTraceEvent;
+
+/**
+ * A slot of the ring, shared by all threads. The fields are atomics guarded by a sequence number,
+ * odd while a writer fills the slot and 2 * (index + 1) once event index is complete. A reader that
+ * sees a field of a newer writer also sees its sequence, so torn events are skipped.
+ */
+typedef struct arena_trace_slot_t {
+    atomic_size_t sequence;
+    _Atomic(const ArenaTraceSite *) site;
+    _Atomic(const void *) arena;
+    atomic_size_t size;
+    _Atomic(uint64_t) time;
+} ArenaTraceSlot;
+
+static _Atomic(ArenaTraceSite *) ArenaTrace_sites;
+static ArenaTraceSlot ArenaTrace_ring[ARENA_TRACE_RING_SIZE];
+static atomic_size_t ArenaTrace_next;
+
+/**
+ * Timestamp of an event: the cycle counter on x86 and ARM64, which costs a few cycles instead of
+ * a clock_gettime call, nanoseconds of CLOCK_MONOTONIC elsewhere. Use it for ordering and to take
+ * differences between events.
+ * @return The current time in ticks
+ */
+static inline uint64_t ArenaTrace_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+/**
+ * Add a callsite to the list of sites on its first call.
+ */
+static ARENA_COLD void ArenaTrace_register(ArenaTraceSite *site) {
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&site->state, &expected, 1)) return;
+    ArenaTraceSite *head = atomic_load_explicit(&ArenaTrace_sites, memory_order_relaxed);
+    do {
+        site->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&ArenaTrace_sites, &head, site, memory_order_release,
+                                                    memory_order_relaxed));
+    atomic_store_explicit(&site->state, 2, memory_order_release);
+}
+
+/**
+ * Record an allocation, called by the tracing macros.
+ * @param site The callsite
+ * @param arena The arena
+ * @param size No. of bytes requested
+ * @param ptr The result of the allocation
+ * @return ptr
+ */
+static inline void *ArenaTrace_record(ArenaTraceSite *site, const void *arena, const size_t size, void *ptr) {
+    if (ARENA_UNLIKELY(atomic_load_explicit(&site->state, memory_order_relaxed) != 2)) ArenaTrace_register(site);
+    atomic_fetch_add_explicit(&site->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&site->bytes, size, memory_order_relaxed);
+    if (ptr == NULL) atomic_fetch_add_explicit(&site->failures, 1, memory_order_relaxed);
+
+    // Claim the slot unless another writer holds it or already wrote a newer event, then drop this one
+    const size_t index = atomic_fetch_add_explicit(&ArenaTrace_next, 1, memory_order_relaxed);
+    ArenaTraceSlot *slot = &ArenaTrace_ring[index & (ARENA_TRACE_RING_SIZE - 1)];
+    size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    if ((sequence & 1) != 0 || sequence > 2 * index ||
+        !atomic_compare_exchange_strong_explicit(&slot->sequence, &sequence, 2 * index + 1, memory_order_relaxed,
+                                                 memory_order_relaxed))
+        return ptr;
+    atomic_store_explicit(&slot->site, site, memory_order_release);
+    atomic_store_explicit(&slot->arena, arena, memory_order_release);
+    atomic_store_explicit(&slot->size, size, memory_order_release);
+    atomic_store_explicit(&slot->time, ArenaTrace_now(), memory_order_release);
+    atomic_store_explicit(&slot->sequence, 2 * index + 2, memory_order_release);
+    return ptr;
+}
+
+/**
+ * Copy the most recent events, newest first. May run while other threads allocate, events that
+ * are being written or were overwritten meanwhile are skipped.
+ * @param events Receives the events
+ * @param max Capacity of events
+ * @return No. of events copied
+ */
+size_t ArenaTrace_recent(ArenaTraceEvent *events, const size_t max) {
+    const size_t next = atomic_load_explicit(&ArenaTrace_next, memory_order_acquire);
+    const size_t recorded = next < ARENA_TRACE_RING_SIZE ? next : ARENA_TRACE_RING_SIZE;
+    size_t count = 0;
+    for (size_t i = 0; i < recorded && count < max; ++i) {
+        const size_t index = next - 1 - i;
+        const ArenaTraceSlot *slot = &ArenaTrace_ring[index & (ARENA_TRACE_RING_SIZE - 1)];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != 2 * index + 2) continue;
+        const ArenaTraceEvent event = {
+            .site = atomic_load_explicit(&slot->site, memory_order_acquire),
+            .arena = atomic_load_explicit(&slot->arena, memory_order_acquire),
+            .size = atomic_load_explicit(&slot->size, memory_order_acquire),
+            .time = atomic_load_explicit(&slot->time, memory_order_acquire),
+        };
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) != 2 * index + 2) continue;
+        events[count++] = event;
+    }
+    return count;
+}
+
+/**
+ * Orders callsites by bytes, descending.
+ */
+static int ArenaTrace_compare_sites(const void *a, const void *b) {
+    const size_t bytes_a = atomic_load_explicit(&(*(ArenaTraceSite *const *)a)->bytes, memory_order_relaxed);
+    const size_t bytes_b = atomic_load_explicit(&(*(ArenaTraceSite *const *)b)->bytes, memory_order_relaxed);
+    return bytes_a < bytes_b ? 1 : bytes_a > bytes_b ? -1 : 0;
+}
+
+/**
+ * Print a heatmap of the callsites: bytes, calls, failures and share of the bytes of every
+ * callsite, the biggest first.
+ * @param out The stream to print to
+ */
+void ArenaTrace_dump(FILE *out) {
+    size_t sites = 0, total = 0;
+    for (ArenaTraceSite *site = atomic_load_explicit(&ArenaTrace_sites, memory_order_acquire); site != NULL; site = site->next) {
+        sites++;
+        total += atomic_load_explicit(&site->bytes, memory_order_relaxed);
+    }
+    ArenaTraceSite **sorted = malloc(sites * sizeof(*sorted) + 1);
+    if (sorted == NULL) return;
+    size_t index = 0;
+    for (ArenaTraceSite *site = atomic_load_explicit(&ArenaTrace_sites, memory_order_acquire); site != NULL && index < sites; site = site->next)
+        sorted[index++] = site;
+    qsort(sorted, sites, sizeof(*sorted), ArenaTrace_compare_sites);
+
+    fprintf(out, "%14s %10s %8s %6s  %-20s %s\n", "bytes", "calls", "failed", "share", "", "callsite");
+    for (size_t i = 0; i < sites; ++i) {
+        const ArenaTraceSite *site = sorted[i];
+        const size_t bytes = atomic_load_explicit(&site->bytes, memory_order_relaxed);
+        const double share = total > 0 ? (double)bytes / (double)total : 0.0;
+        char bar[21] = {0};
+        memset(bar, '#', (size_t)(share * 20.0 + 0.5));
+        fprintf(out, "%14zu %10zu %8zu %5.1f%%  %-20s %s:%u %s\n", bytes,
+                atomic_load_explicit(&site->count, memory_order_relaxed),
+                atomic_load_explicit(&site->failures, memory_order_relaxed), share * 100.0, bar, site->file,
+                site->line, site->function);
+    }
+    free(sorted);
+}
+
+/**
+ * Clear the counters of all callsites and the recent events. Events recorded meanwhile may be lost.
+ */
+void ArenaTrace_reset(void) {
+    for (ArenaTraceSite *site = atomic_load_explicit(&ArenaTrace_sites, memory_order_acquire); site != NULL; site = site->next) {
+        atomic_store_explicit(&site->count, 0, memory_order_relaxed);
+        atomic_store_explicit(&site->bytes, 0, memory_order_relaxed);
+        atomic_store_explicit(&site->failures, 0, memory_order_relaxed);
+    }
+    for (size_t i = 0; i < ARENA_TRACE_RING_SIZE; ++i)
+        atomic_store_explicit(&ArenaTrace_ring[i].sequence, 0, memory_order_relaxed);
+    atomic_store_explicit(&ArenaTrace_next, 0, memory_order_release);
+}
+
+/**
+ * Wrap an allocation call, each expansion gets its own callsite. A function-like macro is not
+ * expanded inside its own expansion, so traced calls the real allocation function.
+ */
+#define ARENA_TRACED(traced, arena, size, ...) __extension__({                                    \
+    static ArenaTraceSite arena_trace_site_ = { .file = __FILE__, .line = __LINE__, .function = #traced }; \
+    __typeof__(arena) arena_trace_arena_ = (arena);                                                 \
+    const size_t arena_trace_size_ = (size);                                                        \
+    (void *)ArenaTrace_record(&arena_trace_site_, arena_trace_arena_, arena_trace_size_,            \
+                              traced(arena_trace_arena_, arena_trace_size_, ##__VA_ARGS__));      \
+})
+
+#define Arena_alloc(arena, size) ARENA_TRACED(Arena_alloc, arena, size)
+#define Arena_alloc_aligned(arena, size, alignment) ARENA_TRACED(Arena_alloc_aligned, arena, size, alignment)
+#define GrowableArena_alloc(arena, size) ARENA_TRACED(GrowableArena_alloc, arena, size)
+#define GrowableArena_alloc_aligned(arena, size, alignment) \
+    ARENA_TRACED(GrowableArena_alloc_aligned, arena, size, alignment)
+#endif
 
 #endif
@@ -0,0 +1,269 @@
+#ifndef ARENA_MAP_C
+#define ARENA_MAP_C
+
+#include "arena.c"
+
+/**
+ * Slots per group of an ArenaMap. The control bytes of a group are matched in one go, compilers
+ * turn the loops into 16 byte vector compares.
+ */
+#define ARENA_MAP_GROUP 16
+
+/**
+ * Control byte values, a full slot holds 7 bits of the hash of its key.
+ */
+#define ARENA_MAP_EMPTY 0x80
+#define ARENA_MAP_DELETED 0xFE
+
+/**
+ * Hash a 64 bit integer key.
+ * @param key The key
+ * @return The hash
+ */
+static inline uint64_t ArenaMap_hash_u64(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ull;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
+
+/**
+ * Hash a byte string, 8 bytes at a time.
+ * @param data The bytes
+ * @param length No. of bytes
+ * @return The hash
+ */
+static inline uint64_t ArenaMap_hash_bytes(const void *data, size_t length) {
+    const unsigned char *bytes = data;
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ length;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+        bytes += 8;
+        length -= 8;
+    }
+    uint64_t word = 0;
+    if (length > 0) memcpy(&word, bytes, length);
+    return ArenaMap_hash_u64(hash ^ word);
+}
+
+/**
+ * Hash and equality of NUL terminated string keys, for maps with const char * keys.
+ */
+static inline uint64_t ArenaMap_hash_string(const char *const *key) {
+    return ArenaMap_hash_bytes(*key, strlen(*key));
+}
+
+static inline bool ArenaMap_equal_string(const char *const *a, const char *const *b) {
+    return strcmp(*a, *b) == 0;
+}
+
+/**
+ * Bit mask of the slots of a group whose control byte equals value.
+ */
+static inline unsigned ArenaMap_match(const uint8_t *control, const uint8_t value) {
+    unsigned mask = 0;
+    for (unsigned i = 0; i < ARENA_MAP_GROUP; ++i) mask |= (unsigned)(control[i] == value) << i;
+    return mask;
+}
+
+/**
+ * Bit mask of the empty or deleted slots of a group, their control bytes are negative.
+ */
+static inline unsigned ArenaMap_match_free(const uint8_t *control) {
+    unsigned mask = 0;
+    for (unsigned i = 0; i < ARENA_MAP_GROUP; ++i) mask |= (unsigned)(control[i] >> 7) << i;
+    return mask;
+}
+
+/**
+ * Index of the lowest set bit.
+ */
+static inline unsigned ArenaMap_lowest_bit(const unsigned bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(bits);
+#else
+    unsigned index = 0;
+    while (!(bits & (1u << index))) index++;
+    return index;
+#endif
+}
+
+/**
+ * Declare a hash map from Key to Value named Name, with storage in a growable arena.
+ *
+ * The layout follows Swiss tables: an array of one control byte per slot, holding 7 bits of the
+ * hash of a full slot, and a separate array of key/value entries. A lookup matches a group of 16
+ * control bytes at once and only compares the keys whose control byte matches. Groups are probed
+ * quadratically, the map grows at 7/8 load. The storage comes from the arena, the arrays a growth
+ * replaces stay there until the arena is reset. There is nothing to free.
+ *
+ * hash is a function uint64_t hash(const Key *key), equal a function bool equal(const Key *a,
+ * const Key *b). ArenaMap_hash_string and ArenaMap_equal_string serve const char * keys.
+ *
+ * Usage:
+ *
+ *     static uint64_t hash_id(const uint64_t *key) { return ArenaMap_hash_u64(*key); }
+ *     static bool equal_id(const uint64_t *a, const uint64_t *b) { return *a == *b; }
+ *     ARENA_MAP_DECLARE(IdMap, uint64_t, double, hash_id, equal_id)
+ *
+ *     IdMap map;
+ *     IdMap_init(&map, &arena, 0);
+ *     IdMap_put(&map, 7, 1.5);
+ *     double *value = IdMap_get(&map, 7);
+ *
+ * Declares Name_init, Name_get, Name_put, Name_remove, Name_next and Name_clear.
+ */
+#define ARENA_MAP_DECLARE(Name, Key, Value, hash, equal)                                           \
+    typedef struct {                                                                               \
+        Key key;                                                                                   \
+        Value value;                                                                               \
+    } Name##Entry;                                                                                 \
+                                                                                                   \
+    typedef struct {                                                                               \
+        GrowableArena *arena;                                                                      \
+        uint8_t *control;                                                                          \
+        Name##Entry *entries;                                                                      \
+        size_t capacity;    /* No. of slots, a power of two and a multiple of ARENA_MAP_GROUP */   \
+        size_t count;       /* No. of full slots */                                                \
+        size_t deleted;     /* No. of deleted slots */                                             \
+    } Name;                                                                                        \
+                                                                                                   \
+    static inline bool Name##_alloc(Name *map, const size_t capacity) {                            \
+        uint8_t *control = GrowableArena_alloc_array(map->arena, capacity, 1, ARENA_MAP_GROUP);    \
+        Name##Entry *entries = GrowableArena_alloc_array(map->arena, capacity, sizeof(Name##Entry), \
+                                                         alignof(Name##Entry));                    \
+        if (control == NULL || entries == NULL) return false;                                      \
+        memset(control, ARENA_MAP_EMPTY, capacity);                                                \
+        map->control = control;                                                                    \
+        map->entries = entries;                                                                    \
+        map->capacity = capacity;                                                                  \
+        map->deleted = 0;                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Initialize an empty map with room for capacity entries, false if allocation failed */      \
+    static inline bool Name##_init(Name *map, GrowableArena *arena, const size_t capacity) {       \
+        if (map == NULL || arena == NULL || capacity > SIZE_MAX / 16) return false;                \
+        size_t slots = ARENA_MAP_GROUP;                                                            \
+        while (slots / 8 * 7 < capacity) slots *= 2;                                               \
+        map->arena = arena;                                                                        \
+        map->count = 0;                                                                            \
+        return Name##_alloc(map, slots);                                                           \
+    }                                                                                              \
+                                                                                                   \
+    static inline Name##Entry *Name##_find(const Name *map, const Key *key, const uint64_t h) {    \
+        const uint8_t tag = (uint8_t)(h >> 57);                                                    \
+        const size_t groups = map->capacity / ARENA_MAP_GROUP;                                     \
+        size_t group = (size_t)h & (groups - 1);                                                   \
+        for (size_t probe = 0; probe < groups; ++probe) {                                          \
+            const uint8_t *control = map->control + group * ARENA_MAP_GROUP;                       \
+            for (unsigned m = ArenaMap_match(control, tag); m != 0; m &= m - 1) {               \
+                Name##Entry *entry = &map->entries[group * ARENA_MAP_GROUP + ArenaMap_lowest_bit(m)]; \
+                if (equal(&entry->key, key)) return entry;                                         \
+            }                                                                                      \
+            if (ArenaMap_match(control, ARENA_MAP_EMPTY) != 0) return NULL;                        \
+            group = (group + probe + 1) & (groups - 1);                                            \
+        }                                                                                          \
+        return NULL;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* First empty or deleted slot on the probe sequence of a hash */                             \
+    static inline size_t Name##_free_slot(const Name *map, const uint64_t h) {                     \
+        const size_t groups = map->capacity / ARENA_MAP_GROUP;                                     \
+        size_t group = (size_t)h & (groups - 1);                                                   \
+        for (size_t probe = 0;; ++probe) {                                                         \
+            const unsigned m = ArenaMap_match_free(map->control + group * ARENA_MAP_GROUP);        \
+            if (m != 0) return group * ARENA_MAP_GROUP + ArenaMap_lowest_bit(m);                   \
+            group = (group + probe + 1) & (groups - 1);                                            \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static inline bool Name##_rehash(Name *map, const size_t capacity) {                           \
+        const Name old = *map;                                                                     \
+        if (!Name##_alloc(map, capacity)) {                                                        \
+            *map = old;                                                                            \
+            return false;                                                                          \
+        }                                                                                          \
+        for (size_t i = 0; i < old.capacity; ++i) {                                                \
+            if (old.control[i] & 0x80) continue;                                                   \
+            const uint64_t h = hash(&old.entries[i].key);                                          \
+            const size_t slot = Name##_free_slot(map, h);                                          \
+            map->control[slot] = (uint8_t)(h >> 57);                                               \
+            map->entries[slot] = old.entries[i];                                                   \
+        }                                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Pointer to the value of a key, NULL if the key is not in the map */                        \
+    static inline Value *Name##_get(const Name *map, const Key key) {                              \
+        if (map == NULL) return NULL;                                                              \
+        Name##Entry *entry = Name##_find(map, &key, hash(&key));                                   \
+        return entry != NULL ? &entry->value : NULL;                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Insert or replace the value of a key, returns a pointer to the stored value or NULL if    \
+       allocation failed */                                                                        \
+    static inline Value *Name##_put(Name *map, const Key key, const Value value) {                 \
+        if (map == NULL) return NULL;                                                              \
+        const uint64_t h = hash(&key);                                                             \
+        Name##Entry *entry = Name##_find(map, &key, h);                                            \
+        if (entry != NULL) {                                                                       \
+            entry->value = value;                                                                  \
+            return &entry->value;                                                                  \
+        }                                                                                          \
+        if (map->count + map->deleted + 1 > map->capacity / 8 * 7) {                               \
+            /* Grow, or only clear the deleted slots if they take most of the room */              \
+            const bool grow = map->count + 1 > map->capacity / 16 * 7;                             \
+            if (grow && map->capacity > SIZE_MAX / 2 / sizeof(Name##Entry)) return NULL;           \
+            if (!Name##_rehash(map, grow ? map->capacity * 2 : map->capacity)) return NULL;        \
+        }                                                                                          \
+        const size_t slot = Name##_free_slot(map, h);                                              \
+        if (map->control[slot] == ARENA_MAP_DELETED) map->deleted--;                               \
+        map->control[slot] = (uint8_t)(h >> 57);                                                   \
+        map->entries[slot].key = key;                                                              \
+        map->entries[slot].value = value;                                                          \
+        map->count++;                                                                              \
+        return &map->entries[slot].value;                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /* Remove a key, false if it is not in the map */                                             \
+    static inline bool Name##_remove(Name *map, const Key key) {                                   \
+        if (map == NULL) return false;                                                             \
+        Name##Entry *entry = Name##_find(map, &key, hash(&key));                                   \
+        if (entry == NULL) return false;                                                           \
+        const size_t slot = (size_t)(entry - map->entries);                                        \
+        const uint8_t *group = map->control + slot / ARENA_MAP_GROUP * ARENA_MAP_GROUP;            \
+        /* No probe went past a group that still has an empty slot, so the slot can be empty */    \
+        if (ArenaMap_match(group, ARENA_MAP_EMPTY) != 0) {                                         \
+            map->control[slot] = ARENA_MAP_EMPTY;                                                  \
+        } else {                                                                                   \
+            map->control[slot] = ARENA_MAP_DELETED;                                                \
+            map->deleted++;                                                                        \
+        }                                                                                          \
+        map->count--;                                                                              \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Iterate the entries: start with *index = 0, returns NULL after the last entry */          \
+    static inline Name##Entry *Name##_next(const Name *map, size_t *index) {                       \
+        if (map == NULL || index == NULL) return NULL;                                             \
+        while (*index < map->capacity) {                                                           \
+            const size_t slot = (*index)++;                                                        \
+            if (!(map->control[slot] & 0x80)) return &map->entries[slot];                          \
+        }                                                                                          \
+        return NULL;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Remove all entries, the storage is kept */                                                 \
+    static inline void Name##_clear(Name *map) {                                                   \
+        if (map == NULL) return;                                                                   \
+        memset(map->control, ARENA_MAP_EMPTY, map->capacity);                                      \
+        map->count = 0;                                                                            \
+        map->deleted = 0;                                                                          \
+    }
+
+#endif
@@ -0,0 +1,371 @@
+#ifndef ARENA_STR_C
+#define ARENA_STR_C
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "arena.c"
+
+/**
+ * String builder on a growable arena.
+ *
+ * The string grows geometrically through GrowableArena_realloc. As long as nothing else is
+ * allocated from the arena meanwhile, the string is the most recent allocation and grows in place
+ * without copying. The string is always NUL terminated.
+ *
+ * Usage:
+ *
+ * 1. Create an ArenaStr struct
+ * 2. Initialize it with the arena to build in: ArenaStr_init
+ * 3. Append with ArenaStr_append, ArenaStr_append_cstr, ArenaStr_append_char or ArenaStr_appendf
+ * 4. Finally, take the string with ArenaStr_finish, it lives as long as the arena memory
+ */
+typedef struct arena_str_t {
+    GrowableArena *arena;
+    char *data;
+    size_t length;
+    size_t capacity;        // Bytes allocated, including the terminating NUL
+} ArenaStr;
+
+/**
+ * Initialize a string builder. Nothing is allocated until the first append.
+ * @param str An empty ArenaStr struct
+ * @param arena The arena to build the string in
+ * @return true for success, false for invalid arguments
+ */
+bool ArenaStr_init(ArenaStr *str, GrowableArena *arena) {
+    if (str == NULL || arena == NULL) return false;
+    str->arena = arena;
+    str->data = NULL;
+    str->length = 0;
+    str->capacity = 0;
+    return true;
+}
+
+/**
+ * Make room for more characters.
+ * @param str The string builder
+ * @param additional No. of characters to make room for
+ * @return true for success, false if allocation failed
+ */
+bool ArenaStr_reserve(ArenaStr *str, const size_t additional) {
+    if (str == NULL) return false;
+    if (additional > SIZE_MAX - str->length - 1) return false;
+    const size_t needed = str->length + additional + 1;
+    if (needed <= str->capacity) return true;
+
+    size_t capacity = str->capacity < 16 ? 16 : str->capacity;
+    while (capacity < needed) capacity = capacity > SIZE_MAX / 2 ? needed : capacity * 2;
+    char *data = GrowableArena_realloc(str->arena, str->data, str->capacity, capacity);
+    if (data == NULL) return false;
+    data[str->length] = '\0';
+    str->data = data;
+    str->capacity = capacity;
+    return true;
+}
+
+/**
+ * Append characters to the string.
+ * @param str The string builder
+ * @param chars The characters, they need not be NUL terminated
+ * @param length No. of characters
+ * @return true for success, false if allocation failed
+ */
+bool ArenaStr_append(ArenaStr *str, const char *chars, const size_t length) {
+    if (!ArenaStr_reserve(str, length)) return false;
+    if (length > 0) memcpy(str->data + str->length, chars, length);
+    str->length += length;
+    str->data[str->length] = '\0';
+    return true;
+}
+
+/**
+ * Append a NUL terminated string.
+ * @param str The string builder
+ * @param cstr The string
+ * @return true for success, false if allocation failed
+ */
+bool ArenaStr_append_cstr(ArenaStr *str, const char *cstr) {
+    if (cstr == NULL) return false;
+    return ArenaStr_append(str, cstr, strlen(cstr));
+}
+
+/**
+ * Append a single character.
+ * @param str The string builder
+ * @param c The character
+ * @return true for success, false if allocation failed
+ */
+bool ArenaStr_append_char(ArenaStr *str, const char c) {
+    return ArenaStr_append(str, &c, 1);
+}
+
+/**
+ * Append formatted output like printf. The output is formatted straight into the string.
+ * @param str The string builder
+ * @param format The printf format
+ * @return true for success, false if formatting or allocation failed
+ */
+bool ArenaStr_appendf(ArenaStr *str, const char *format, ...) {
+    if (str == NULL || format == NULL) return false;
+    if (!ArenaStr_reserve(str, 0)) return false;
+
+    va_list args, retry;
+    va_start(args, format);
+    va_copy(retry, args);
+    const size_t room = str->capacity - str->length;
+    const int length = vsnprintf(str->data + str->length, room, format, args);
+    va_end(args);
+    bool ok = length >= 0;
+    if (ok && (size_t)length >= room) {
+        // Did not fit, format again into a big enough string
+        ok = ArenaStr_reserve(str, (size_t)length) &&
+             vsnprintf(str->data + str->length, (size_t)length + 1, format, retry) == length;
+    }
+    va_end(retry);
+    if (!ok) {
+        str->data[str->length] = '\0';
+        return false;
+    }
+    str->length += (size_t)length;
+    return true;
+}
+
+/**
+ * Finish the string. The unused capacity is handed back to the arena if the string is still its
+ * most recent allocation. The builder is empty afterwards and can build the next string.
+ * @param str The string builder
+ * @return The NUL terminated string or NULL if allocation failed
+ */
+const char *ArenaStr_finish(ArenaStr *str) {
+    if (!ArenaStr_reserve(str, 0)) return NULL;
+    char *data = str->data;
+    Arena_resize_last(&str->arena->current->arena, data, str->capacity, str->length + 1);
+    str->data = NULL;
+    str->length = 0;
+    str->capacity = 0;
+    return data;
+}
+
+/**
+ * Slots per probe group of the intern table. The hashes of a group fill half a cache line and are
+ * compared in one go, compilers turn the loop into vector compares.
+ */
+#define ARENA_INTERN_GROUP 8
+
+/**
+ * Hash based table of unique strings.
+ *
+ * Interning returns the same pointer for equal strings, so interned strings compare with ==.
+ * The table uses open addressing with parallel arrays: the 32 bit hashes, scanned a group at a
+ * time, and the strings with their lengths, only touched when a hash matches. Strings, slots and
+ * all growth come from a growable arena, so there is nothing to free: resetting or freeing the
+ * arena drops the whole table. The slot arrays a growth replaces stay in the arena until then,
+ * because the table doubles they take less room than the current arrays.
+ */
+typedef struct arena_intern_table_t {
+    GrowableArena *arena;
+    uint32_t *hashes;       // 0 marks an empty slot
+    const char **strings;
+    size_t *lengths;
+    size_t capacity;        // No. of slots, a power of two and at least ARENA_INTERN_GROUP
+    size_t count;
+} ArenaInternTable;
+
+/**
+ * Hash a string, 8 bytes at a time. Never returns 0, which marks an empty slot.
+ * @param chars The characters
+ * @param length No. of characters
+ * @return The hash
+ */
+static inline uint32_t ArenaInternTable_hash(const char *chars, size_t length) {
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ length;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, chars, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+        chars += 8;
+        length -= 8;
+    }
+    uint64_t word = 0;
+    if (length > 0) memcpy(&word, chars, length);
+    hash = (hash ^ word) * 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 29;
+    const uint32_t result = (uint32_t)(hash >> 32);
+    return result != 0 ? result : 1;
+}
+
+/**
+ * Index of the lowest set bit.
+ */
+static inline unsigned ArenaInternTable_lowest_bit(const unsigned bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(bits);
+#else
+    unsigned index = 0;
+    while (!(bits & (1u << index))) index++;
+    return index;
+#endif
+}
+
+/**
+ * Allocate the slot arrays for a capacity.
+ * @return true for success, false if allocation failed
+ */
+static bool ArenaInternTable_alloc_slots(ArenaInternTable *table, const size_t capacity) {
+    uint32_t *hashes = GrowableArena_alloc_array(table->arena, capacity, sizeof(uint32_t), 32);
+    const char **strings = GrowableArena_alloc_array(table->arena, capacity, sizeof(const char *), alignof(const char *));
+    size_t *lengths = GrowableArena_alloc_array(table->arena, capacity, sizeof(size_t), alignof(size_t));
+    if (hashes == NULL || strings == NULL || lengths == NULL) return false;
+    memset(hashes, 0, capacity * sizeof(uint32_t));
+    table->hashes = hashes;
+    table->strings = strings;
+    table->lengths = lengths;
+    table->capacity = capacity;
+    return true;
+}
+
+/**
+ * Initialize an intern table.
+ * @param table An empty ArenaInternTable struct
+ * @param arena The arena for the strings and the slots
+ * @param capacity Expected no. of strings, the table grows beyond it as needed
+ * @return true for success, false if allocation failed
+ */
+bool ArenaInternTable_init(ArenaInternTable *table, GrowableArena *arena, const size_t capacity) {
+    if (table == NULL || arena == NULL) return false;
+    if (capacity > SIZE_MAX / 8) return false;
+
+    // Keep the load factor at 3/4
+    size_t slots = ARENA_INTERN_GROUP;
+    while (slots / 4 * 3 < capacity) slots *= 2;
+    table->arena = arena;
+    table->count = 0;
+    return ArenaInternTable_alloc_slots(table, slots);
+}
+
+/**
+ * Look up the slot of a string.
+ * @param table The intern table
+ * @param hash Hash of the string
+ * @param chars The characters
+ * @param length No. of characters
+ * @param found Receives whether the string is in the table
+ * @return Index of the slot holding the string, or of the empty slot to insert it at
+ */
+static inline size_t ArenaInternTable_probe(const ArenaInternTable *table, const uint32_t hash, const char *chars,
+                                            const size_t length, bool *found) {
+    const size_t groups = table->capacity / ARENA_INTERN_GROUP;
+    size_t group = (hash / ARENA_INTERN_GROUP) & (groups - 1);
+    for (;;) {
+        const uint32_t *hashes = table->hashes + group * ARENA_INTERN_GROUP;
+        unsigned matches = 0, empty = 0;
+        for (unsigned i = 0; i < ARENA_INTERN_GROUP; ++i) {
+            matches |= (unsigned)(hashes[i] == hash) << i;
+            empty |= (unsigned)(hashes[i] == 0) << i;
+        }
+        for (; matches != 0; matches &= matches - 1) {
+            const size_t slot = group * ARENA_INTERN_GROUP + ArenaInternTable_lowest_bit(matches);
+            if (table->lengths[slot] == length && memcmp(table->strings[slot], chars, length) == 0) {
+                *found = true;
+                return slot;
+            }
+        }
+        if (empty != 0) {
+            *found = false;
+            return group * ARENA_INTERN_GROUP + ArenaInternTable_lowest_bit(empty);
+        }
+        group = (group + 1) & (groups - 1);
+    }
+}
+
+/**
+ * Double the capacity of the table.
+ * @return true for success, false if allocation failed
+ */
+static bool ArenaInternTable_grow(ArenaInternTable *table) {
+    if (table->capacity > SIZE_MAX / 2 / sizeof(const char *)) return false;
+    const ArenaInternTable old = *table;
+    if (!ArenaInternTable_alloc_slots(table, old.capacity * 2)) return false;
+
+    const size_t groups = table->capacity / ARENA_INTERN_GROUP;
+    for (size_t slot = 0; slot < old.capacity; ++slot) {
+        const uint32_t hash = old.hashes[slot];
+        if (hash == 0) continue;
+        // All strings are unique, only look for an empty slot
+        size_t group = (hash / ARENA_INTERN_GROUP) & (groups - 1), target = 0;
+        for (;;) {
+            const uint32_t *hashes = table->hashes + group * ARENA_INTERN_GROUP;
+            unsigned empty = 0;
+            for (unsigned i = 0; i < ARENA_INTERN_GROUP; ++i) empty |= (unsigned)(hashes[i] == 0) << i;
+            if (empty != 0) {
+                target = group * ARENA_INTERN_GROUP + ArenaInternTable_lowest_bit(empty);
+                break;
+            }
+            group = (group + 1) & (groups - 1);
+        }
+        table->hashes[target] = hash;
+        table->strings[target] = old.strings[slot];
+        table->lengths[target] = old.lengths[slot];
+    }
+    return true;
+}
+
+/**
+ * Find an interned string.
+ * @param table The intern table
+ * @param chars The characters, they need not be NUL terminated
+ * @param length No. of characters
+ * @return The interned string or NULL if it is not in the table
+ */
+const char *ArenaInternTable_find(const ArenaInternTable *table, const char *chars, const size_t length) {
+    if (table == NULL || (chars == NULL && length > 0)) return NULL;
+    bool found = false;
+    const size_t slot = ArenaInternTable_probe(table, ArenaInternTable_hash(chars, length), chars, length, &found);
+    return found ? table->strings[slot] : NULL;
+}
+
+/**
+ * Intern a string: return the copy in the table, adding one if it is not there yet.
+ * @param table The intern table
+ * @param chars The characters, they need not be NUL terminated
+ * @param length No. of characters
+ * @return The NUL terminated interned string or NULL if allocation failed
+ */
+const char *ArenaInternTable_intern(ArenaInternTable *table, const char *chars, const size_t length) {
+    if (table == NULL || (chars == NULL && length > 0)) return NULL;
+    if (length == SIZE_MAX) return NULL;
+    const uint32_t hash = ArenaInternTable_hash(chars, length);
+    bool found = false;
+    size_t slot = ArenaInternTable_probe(table, hash, chars, length, &found);
+    if (found) return table->strings[slot];
+
+    if (table->count + 1 > table->capacity / 4 * 3) {
+        if (!ArenaInternTable_grow(table)) return NULL;
+        slot = ArenaInternTable_probe(table, hash, chars, length, &found);
+    }
+
+    char *copy = GrowableArena_alloc(table->arena, length + 1);
+    if (copy == NULL) return NULL;
+    if (length > 0) memcpy(copy, chars, length);
+    copy[length] = '\0';
+    table->hashes[slot] = hash;
+    table->strings[slot] = copy;
+    table->lengths[slot] = length;
+    table->count++;
+    return copy;
+}
+
+/**
+ * Intern a NUL terminated string.
+ * @param table The intern table
+ * @param cstr The string
+ * @return The interned string or NULL if allocation failed
+ */
+const char *ArenaInternTable_intern_cstr(ArenaInternTable *table, const char *cstr) {
+    if (cstr == NULL) return NULL;
+    return ArenaInternTable_intern(table, cstr, strlen(cstr));
+}
+
+#endif
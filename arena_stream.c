@@ -0,0 +1,251 @@
+#ifndef ARENA_STREAM_C
+#define ARENA_STREAM_C
+
+#include <errno.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "arena.c"
+#include "arena_vec.c"
+
+/**
+ * Most chunks passed to a single writev.
+ */
+#ifdef IOV_MAX
+#define ARENA_STREAM_IOV_MAX IOV_MAX
+#else
+#define ARENA_STREAM_IOV_MAX 1024
+#endif
+
+/**
+ * Chunked byte stream on a growable arena, for I/O without flattening.
+ *
+ * Appended bytes are copied into the pages of the arena, each run that fits into the active page
+ * is one chunk. A run that continues the previous chunk in memory extends it, so a stream that is
+ * built without other allocations in between has one chunk per page. The chunks are an iovec
+ * array, ready for writev, sendmsg or an io_uring submission. Bytes that already live elsewhere,
+ * a mapped file for instance, can be added as a chunk without copying.
+ *
+ * Usage:
+ *
+ * 1. Create an ArenaStream struct
+ * 2. Initialize it with the arena to buffer in: ArenaStream_init
+ * 3. Append with ArenaStream_append and ArenaStream_append_ref, or receive with ArenaStream_read
+ * 4. Send with ArenaStream_write, or take the chunks with ArenaStream_iovec and ArenaStream_consume
+ *
+ * The bytes live as long as the arena memory, consuming them does not release memory.
+ */
+typedef struct arena_stream_t {
+    GrowableArena *arena;
+    struct iovec *chunks;
+    size_t first;           // First chunk not consumed yet
+    size_t count;           // No. of chunks, including the consumed ones
+    size_t capacity;        // No. of chunks the array can hold
+    size_t length;          // No. of bytes not consumed yet
+} ArenaStream;
+
+/**
+ * Initialize a stream. Nothing is allocated until the first append.
+ * @param stream An empty ArenaStream struct
+ * @param arena The arena to buffer in
+ * @return true for success, false for invalid arguments
+ */
+bool ArenaStream_init(ArenaStream *stream, GrowableArena *arena) {
+    if (stream == NULL || arena == NULL) return false;
+    stream->arena = arena;
+    stream->chunks = NULL;
+    stream->first = 0;
+    stream->count = 0;
+    stream->capacity = 0;
+    stream->length = 0;
+    return true;
+}
+
+/**
+ * Make room for one more chunk. Runs before the bytes of the chunk are allocated, so growing the
+ * array does not split a run.
+ * @param stream The stream
+ * @return true for success, false if allocation failed
+ */
+static bool ArenaStream_reserve_chunk(ArenaStream *stream) {
+    if (ARENA_LIKELY(stream->count < stream->capacity)) return true;
+    struct iovec *chunks = ArenaVec_grow(stream->arena, stream->chunks, &stream->capacity, stream->count + 1,
+                                         sizeof(struct iovec));
+    if (chunks == NULL) return false;
+    stream->chunks = chunks;
+    return true;
+}
+
+/**
+ * Add a run of bytes to the end of the stream, extending the last chunk if the run continues it.
+ * @param stream The stream, with room for one more chunk
+ * @param data The bytes
+ * @param size No. of bytes
+ */
+static void ArenaStream_push(ArenaStream *stream, void *data, const size_t size) {
+    struct iovec *last = stream->count > stream->first ? &stream->chunks[stream->count - 1] : NULL;
+    if (last != NULL && (char *)last->iov_base + last->iov_len == (char *)data) {
+        last->iov_len += size;
+    } else {
+        stream->chunks[stream->count++] = (struct iovec){ .iov_base = data, .iov_len = size };
+    }
+    stream->length += size;
+}
+
+/**
+ * Copy bytes to the end of the stream. The bytes fill the active page of the arena to the end
+ * before a new page is started.
+ * @param stream The stream
+ * @param data The bytes
+ * @param size No. of bytes
+ * @return true for success, false if allocation failed, the bytes appended so far stay
+ */
+bool ArenaStream_append(ArenaStream *stream, const void *data, size_t size) {
+    if (stream == NULL || (data == NULL && size > 0)) return false;
+    const char *bytes = data;
+    while (size > 0) {
+        if (!ArenaStream_reserve_chunk(stream)) return false;
+        size_t got;
+        char *run = GrowableArena_alloc_batch(stream->arena, size, 1, 1, &got);
+        if (run == NULL) return false;
+        memcpy(run, bytes, got);
+        ArenaStream_push(stream, run, got);
+        bytes += got;
+        size -= got;
+    }
+    return true;
+}
+
+/**
+ * Add bytes to the end of the stream without copying them. The bytes must stay valid until the
+ * stream has been written.
+ * @param stream The stream
+ * @param data The bytes
+ * @param size No. of bytes
+ * @return true for success, false if allocation failed
+ */
+bool ArenaStream_append_ref(ArenaStream *stream, const void *data, const size_t size) {
+    if (stream == NULL || (data == NULL && size > 0)) return false;
+    if (size == 0) return true;
+    if (!ArenaStream_reserve_chunk(stream)) return false;
+    ArenaStream_push(stream, (void *)data, size);
+    return true;
+}
+
+/**
+ * The chunks of the stream that are not consumed yet.
+ * @param stream The stream
+ * @param count Receives the no. of chunks
+ * @return The chunks, valid until the stream is changed
+ */
+const struct iovec *ArenaStream_iovec(const ArenaStream *stream, size_t *count) {
+    if (count != NULL) *count = 0;
+    if (stream == NULL || stream->first == stream->count) return NULL;
+    if (count != NULL) *count = stream->count - stream->first;
+    return stream->chunks + stream->first;
+}
+
+/**
+ * Drop bytes from the front of the stream, after they have been sent.
+ * @param stream The stream
+ * @param size No. of bytes, at most the length of the stream
+ */
+void ArenaStream_consume(ArenaStream *stream, size_t size) {
+    if (stream == NULL) return;
+    if (size > stream->length) size = stream->length;
+    stream->length -= size;
+    while (size > 0) {
+        struct iovec *chunk = &stream->chunks[stream->first];
+        if (size < chunk->iov_len) {
+            chunk->iov_base = (char *)chunk->iov_base + size;
+            chunk->iov_len -= size;
+            break;
+        }
+        size -= chunk->iov_len;
+        stream->first++;
+    }
+    // Reuse the chunk array once everything is consumed
+    if (stream->length == 0) {
+        stream->first = 0;
+        stream->count = 0;
+    }
+}
+
+/**
+ * Write the stream to a file descriptor with writev and consume what was written. Retries on
+ * EINTR and after partial writes until the stream is empty or the descriptor would block.
+ * @param stream The stream
+ * @param fd The file descriptor
+ * @return No. of bytes written or -1 with errno set, the bytes not written stay in the stream
+ */
+ssize_t ArenaStream_write(ArenaStream *stream, const int fd) {
+    if (stream == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t written = 0;
+    while (stream->length > 0) {
+        const size_t chunks = stream->count - stream->first;
+        const ssize_t count = writev(fd, stream->chunks + stream->first,
+                                     (int)(chunks < ARENA_STREAM_IOV_MAX ? chunks : ARENA_STREAM_IOV_MAX));
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return written > 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ? (ssize_t)written : -1;
+        ArenaStream_consume(stream, (size_t)count);
+        written += (size_t)count;
+    }
+    return (ssize_t)written;
+}
+
+/**
+ * Receive up to size bytes from a file descriptor straight into the free tail of the active page
+ * and append them to the stream. A new page is only started when the active one is full, the
+ * part of the tail the read did not fill is handed back to the arena.
+ * @param stream The stream
+ * @param fd The file descriptor
+ * @param size Most bytes to read, a single call reads at most to the end of the page
+ * @return No. of bytes read, 0 at end of file or -1 with errno set
+ */
+ssize_t ArenaStream_read(ArenaStream *stream, const int fd, const size_t size) {
+    if (stream == NULL || size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!ArenaStream_reserve_chunk(stream)) {
+        errno = ENOMEM;
+        return -1;
+    }
+    size_t got;
+    char *tail = GrowableArena_alloc_batch(stream->arena, size > SSIZE_MAX ? SSIZE_MAX : size, 1, 1, &got);
+    if (tail == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    ssize_t count;
+    do {
+        count = read(fd, tail, got);
+    } while (count < 0 && errno == EINTR);
+    const size_t filled = count > 0 ? (size_t)count : 0;
+    if (filled < got) {
+        const int error = errno;
+        Arena_resize_last(&stream->arena->current->arena, tail, got, filled);
+        errno = error;
+    }
+    if (filled > 0) ArenaStream_push(stream, tail, filled);
+    return count;
+}
+
+/**
+ * Empty the stream. The memory of the bytes stays in the arena until it is reset.
+ * @param stream The stream
+ */
+void ArenaStream_reset(ArenaStream *stream) {
+    if (stream == NULL) return;
+    stream->first = 0;
+    stream->count = 0;
+    stream->length = 0;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef ARENA_VEC_C
+#define ARENA_VEC_C
+
+#include "arena.c"
+
+/**
+ * Grow the storage of a vector to hold at least needed items. The capacity doubles, the storage
+ * grows through GrowableArena_realloc: in place while it is the most recent allocation of the
+ * arena, as a large block once it outgrows a page.
+ * @param arena The arena
+ * @param items The current storage or NULL
+ * @param capacity Current capacity in items, receives the new capacity
+ * @param needed No. of items the storage must hold
+ * @param item_size Size of an item in bytes
+ * @return The new storage or NULL if allocation failed, the old storage is left untouched then
+ */
+static void *ArenaVec_grow(GrowableArena *arena, void *items, size_t *capacity, const size_t needed, const size_t item_size) {
+    size_t grown = *capacity < 8 ? 8 : *capacity;
+    while (grown < needed) grown = grown > SIZE_MAX / 2 ? needed : grown * 2;
+    if (item_size != 0 && grown > SIZE_MAX / item_size) return NULL;
+
+    void *storage = GrowableArena_realloc(arena, items, *capacity * item_size, grown * item_size);
+    if (storage == NULL) return NULL;
+    *capacity = grown;
+    return storage;
+}
+
+/**
+ * Declare a dynamic array of Type named Name, with storage in a growable arena.
+ *
+ * Items are aligned to ARENA_DEFAULT_ALIGNMENT, so Type must not need more. There is nothing to
+ * free: the storage goes away with the arena.
+ *
+ * Usage:
+ *
+ *     ARENA_VEC_DECLARE(IntVec, int)
+ *
+ *     IntVec vec;
+ *     IntVec_init(&vec, &arena, 0);
+ *     IntVec_push(&vec, 42);
+ *     int *first = IntVec_at(&vec, 0);
+ *
+ * Declares Name_init, Name_reserve, Name_push, Name_append, Name_pop, Name_at and Name_clear.
+ */
+#define ARENA_VEC_DECLARE(Name, Type)                                                              \
+    typedef struct {                                                                               \
+        GrowableArena *arena;                                                                      \
+        Type *items;                                                                               \
+        size_t length;                                                                             \
+        size_t capacity;                                                                           \
+    } Name;                                                                                        \
+                                                                                                   \
+    /* Make room for at least capacity items, false if allocation failed */                       \
+    static inline bool Name##_reserve(Name *vec, const size_t capacity) {                          \
+        if (vec == NULL) return false;                                                             \
+        if (capacity <= vec->capacity) return true;                                                \
+        Type *items = ArenaVec_grow(vec->arena, vec->items, &vec->capacity, capacity, sizeof(Type)); \
+        if (items == NULL) return false;                                                           \
+        vec->items = items;                                                                        \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Initialize an empty vector, optionally with room for capacity items */                     \
+    static inline bool Name##_init(Name *vec, GrowableArena *arena, const size_t capacity) {       \
+        if (vec == NULL || arena == NULL) return false;                                            \
+        vec->arena = arena;                                                                        \
+        vec->items = NULL;                                                                         \
+        vec->length = 0;                                                                           \
+        vec->capacity = 0;                                                                         \
+        return capacity == 0 || Name##_reserve(vec, capacity);                                     \
+    }                                                                                              \
+                                                                                                   \
+    /* Append an item, false if allocation failed */                                              \
+    static inline bool Name##_push(Name *vec, const Type item) {                                   \
+        if (vec == NULL) return false;                                                             \
+        if (ARENA_UNLIKELY(vec->length == vec->capacity) && !Name##_reserve(vec, vec->length + 1)) \
+            return false;                                                                          \
+        vec->items[vec->length++] = item;                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Append count items, false if allocation failed */                                          \
+    static inline bool Name##_append(Name *vec, const Type *items, const size_t count) {           \
+        if (vec == NULL || count > SIZE_MAX - vec->length) return false;                           \
+        if (!Name##_reserve(vec, vec->length + count)) return false;                               \
+        if (count > 0) memcpy(vec->items + vec->length, items, count * sizeof(Type));              \
+        vec->length += count;                                                                      \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Remove the last item, false if the vector is empty */                                      \
+    static inline bool Name##_pop(Name *vec, Type *item) {                                         \
+        if (vec == NULL || vec->length == 0) return false;                                         \
+        vec->length--;                                                                             \
+        if (item != NULL) *item = vec->items[vec->length];                                         \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Pointer to the item at index, NULL if out of bounds */                                     \
+    static inline Type *Name##_at(const Name *vec, const size_t index) {                           \
+        if (vec == NULL || index >= vec->length) return NULL;                                      \
+        return &vec->items[index];                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    /* Remove all items, the storage is kept */                                                   \
+    static inline void Name##_clear(Name *vec) {                                                   \
+        if (vec != NULL) vec->length = 0;                                                          \
+    }
+
+#endif
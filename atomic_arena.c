@@ -0,0 +1,321 @@
+#ifndef ATOMIC_ARENA_C
+#define ATOMIC_ARENA_C
+
+#include <stdatomic.h>
+
+#include "arena.c"
+
+/**
+ * Thread-safe statically-sized arena allocator.
+ *
+ * Works like Arena, but any number of threads can allocate from it concurrently. Allocation is a
+ * single atomic fetch-add on the offset. A failed allocation leaves the offset beyond the capacity,
+ * so the tail of a full arena is not handed out anymore. Reset and free must not run concurrently
+ * with allocations.
+ */
+typedef struct atomic_arena_t {
+    void * data;
+    size_t capacity;
+    _Atomic size_t next_offset;
+} AtomicArena;
+
+/**
+ * Initialize an atomic arena.
+ * @param arena An empty AtomicArena struct
+ * @param capacity No. of bytes to allocate
+ * @return true for success, false if allocation failed
+ */
+bool AtomicArena_init(AtomicArena *arena, const size_t capacity) {
+    if (arena == NULL) return false;
+    void *data = malloc(capacity);
+    if (data == NULL) return false;
+    arena->data = data;
+    arena->capacity = capacity;
+    atomic_init(&arena->next_offset, 0);
+    return true;
+}
+
+/**
+ * Allocate aligned memory from the atomic arena. Aligned allocation needs a compare-and-swap loop,
+ * as the padding depends on the current offset.
+ * @param arena The atomic arena
+ * @param size No. of bytes to allocate in the arena
+ * @param alignment Alignment of the memory block, a power of two up to ARENA_MAX_ALIGNMENT
+ * @return Pointer to the memory block or NULL if there was not enough memory left
+ */
+void *AtomicArena_alloc_aligned(AtomicArena *arena, const size_t size, const size_t alignment) {
+    if (arena == NULL) return NULL;
+    if (!Arena_valid_alignment(alignment)) return NULL;
+
+    const uintptr_t base = (uintptr_t)arena->data;
+    size_t next_offset = atomic_load_explicit(&arena->next_offset, memory_order_relaxed);
+    size_t offset;
+    do {
+        if (next_offset > arena->capacity) return NULL;
+        const uintptr_t address = (base + next_offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        offset = address - base;
+        if (offset > arena->capacity || size > arena->capacity - offset) return NULL;
+    } while (!atomic_compare_exchange_weak_explicit(&arena->next_offset, &next_offset, offset + size,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    return (char *)arena->data + offset;
+}
+
+/**
+ * Allocate memory from the atomic arena. The memory is not aligned, unless ARENA_ALIGN_BY_DEFAULT
+ * is defined.
+ * @param arena The atomic arena
+ * @param size No. of bytes to allocate in the arena
+ * @return Pointer to the memory block or NULL if there was not enough memory left
+ */
+void *AtomicArena_alloc(AtomicArena *arena, const size_t size) {
+#ifdef ARENA_ALIGN_BY_DEFAULT
+    return AtomicArena_alloc_aligned(arena, size, ARENA_DEFAULT_ALIGNMENT);
+#else
+    if (arena == NULL) return NULL;
+    if (size > arena->capacity) return NULL;
+    const size_t offset = atomic_fetch_add_explicit(&arena->next_offset, size, memory_order_relaxed);
+    if (offset > arena->capacity - size) return NULL;
+    return (char *)arena->data + offset;
+#endif
+}
+
+/**
+ * Resets the atomic arena to zero. Must not run concurrently with allocations.
+ * @param arena The atomic arena to reset
+ */
+void AtomicArena_reset(AtomicArena *arena) {
+    if (arena == NULL) return;
+    atomic_store_explicit(&arena->next_offset, 0, memory_order_relaxed);
+}
+
+/**
+ * Release the memory allocated by the arena. After this call, the arena cannot be used anymore.
+ * @param arena The arena to free.
+ */
+void AtomicArena_free(AtomicArena *arena) {
+    if (arena != NULL && arena->data != NULL) {
+        free(arena->data);
+        arena->data = NULL;
+    }
+}
+
+/**
+ * Returns the amount of available bytes left for allocation.
+ * @param arena
+ * @return Number of bytes available.
+ */
+size_t AtomicArena_remaining(const AtomicArena *arena) {
+    if (arena == NULL) return 0;
+    const size_t next_offset = atomic_load_explicit(&arena->next_offset, memory_order_relaxed);
+    return next_offset < arena->capacity ? arena->capacity - next_offset : 0;
+}
+
+/**
+ * A page of an atomic growable arena, header and data share a single memory block.
+ */
+typedef struct atomic_arena_page_t {
+    struct atomic_arena_page_t *next;
+    AtomicArena arena;
+} AtomicArenaPage;
+
+/**
+ * Size of the page header, rounded up so the page data keeps the alignment of malloc.
+ */
+#define ATOMIC_ARENA_PAGE_HEADER_SIZE \
+    ((sizeof(AtomicArenaPage) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+
+/**
+ * Thread-safe growable arena allocator.
+ *
+ * Threads bump from the active page (current) with AtomicArena. When it is full, a thread allocates
+ * a new page and installs it with a compare-and-swap; a thread that loses the race frees its page
+ * and continues on the winner's page. Pages are pushed in front of the list, next points to the
+ * previous page. Requests that do not fit into a page get a dedicated block on the large list.
+ *
+ * Reset and free must not run concurrently with allocations. Reset keeps only the active page.
+ */
+typedef struct atomic_growable_arena_t {
+    size_t page_size;
+    _Atomic(AtomicArenaPage *) current;
+    _Atomic(AtomicArenaPage *) large;
+    _Atomic size_t pages;
+} AtomicGrowableArena;
+
+/**
+ * Allocate a new page with header and data in a single memory block.
+ * @param capacity No. of bytes available in the page
+ * @return The new page or NULL if allocation failed
+ */
+static AtomicArenaPage *AtomicArenaPage_new(const size_t capacity) {
+    if (capacity > SIZE_MAX - ATOMIC_ARENA_PAGE_HEADER_SIZE) return NULL;
+    AtomicArenaPage *page = malloc(ATOMIC_ARENA_PAGE_HEADER_SIZE + capacity);
+    if (page == NULL) return NULL;
+    page->next = NULL;
+    page->arena.data = (char *)page + ATOMIC_ARENA_PAGE_HEADER_SIZE;
+    page->arena.capacity = capacity;
+    atomic_init(&page->arena.next_offset, 0);
+    return page;
+}
+
+/**
+ * Release a list of pages.
+ * @param page The first page of the list
+ */
+static void AtomicArenaPage_free_list(AtomicArenaPage *page) {
+    while (page != NULL) {
+        AtomicArenaPage *next = page->next;
+        free(page);
+        page = next;
+    }
+}
+
+/**
+ * Initialize an atomic growable arena.
+ * @param arena An empty AtomicGrowableArena struct
+ * @param page_size The size of a single page in bytes
+ * @return true for success, false if allocation failed
+ */
+bool AtomicGrowableArena_init(AtomicGrowableArena *arena, const size_t page_size) {
+    if (arena == NULL) return false;
+
+    AtomicArenaPage *page = AtomicArenaPage_new(page_size);
+    if (!page) return false;
+    arena->page_size = page_size;
+    atomic_init(&arena->current, page);
+    atomic_init(&arena->large, NULL);
+    atomic_init(&arena->pages, 1);
+    return true;
+}
+
+/**
+ * Allocate a dedicated block for a request that does not fit into a page and push it onto the large
+ * list.
+ * @param arena The atomic growable arena
+ * @param size No. of bytes to allocate
+ * @param alignment Alignment of the memory block
+ * @return Pointer to the memory block or NULL if allocation failed
+ */
+static void *AtomicGrowableArena_alloc_large(AtomicGrowableArena *arena, const size_t size, const size_t alignment) {
+    const size_t padding = ArenaPage_padding(alignment);
+    if (size > SIZE_MAX - padding) return NULL;
+
+    AtomicArenaPage *block = AtomicArenaPage_new(size + padding);
+    if (!block) return NULL;
+    void *mem = AtomicArena_alloc_aligned(&block->arena, size, alignment);
+
+    AtomicArenaPage *head = atomic_load_explicit(&arena->large, memory_order_relaxed);
+    do {
+        block->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&arena->large, &head, block,
+                                                    memory_order_release, memory_order_relaxed));
+    return mem;
+}
+
+/**
+ * Install a new page after page turned out to be full.
+ * @param arena The atomic growable arena
+ * @param page The full page
+ * @return false if allocation failed
+ */
+static bool AtomicGrowableArena_next_page(AtomicGrowableArena *arena, AtomicArenaPage *page) {
+    AtomicArenaPage *fresh = AtomicArenaPage_new(arena->page_size);
+    if (!fresh) return false;
+    fresh->next = page;
+    if (atomic_compare_exchange_strong_explicit(&arena->current, &page, fresh,
+                                                memory_order_acq_rel, memory_order_acquire)) {
+        atomic_fetch_add_explicit(&arena->pages, 1, memory_order_relaxed);
+    } else {
+        // Another thread installed a page first, continue on that one
+        free(fresh);
+    }
+    return true;
+}
+
+/**
+ * Allocate memory from the atomic growable arena. The memory is aligned like Arena_alloc.
+ * @param arena The atomic growable arena
+ * @param size No. of bytes to allocate
+ * @return Pointer to the memory block or NULL if allocation failed
+ */
+void *AtomicGrowableArena_alloc(AtomicGrowableArena *arena, const size_t size) {
+    if (arena == NULL) return NULL;
+    if (size > arena->page_size) return AtomicGrowableArena_alloc_large(arena, size, 1);
+
+    for (;;) {
+        AtomicArenaPage *page = atomic_load_explicit(&arena->current, memory_order_acquire);
+        void *mem = AtomicArena_alloc(&page->arena, size);
+        if (mem) return mem;
+        if (!AtomicGrowableArena_next_page(arena, page)) return NULL;
+    }
+}
+
+/**
+ * Allocate aligned memory from the atomic growable arena.
+ * @param arena The atomic growable arena
+ * @param size No. of bytes to allocate
+ * @param alignment Alignment of the memory block, a power of two up to ARENA_MAX_ALIGNMENT
+ * @return Pointer to the memory block or NULL if allocation failed
+ */
+void *AtomicGrowableArena_alloc_aligned(AtomicGrowableArena *arena, const size_t size, const size_t alignment) {
+    if (arena == NULL) return NULL;
+    if (!Arena_valid_alignment(alignment)) return NULL;
+    const size_t padding = ArenaPage_padding(alignment);
+    if (padding > arena->page_size || size > arena->page_size - padding)
+        return AtomicGrowableArena_alloc_large(arena, size, alignment);
+
+    for (;;) {
+        AtomicArenaPage *page = atomic_load_explicit(&arena->current, memory_order_acquire);
+        void *mem = AtomicArena_alloc_aligned(&page->arena, size, alignment);
+        if (mem) return mem;
+        if (!AtomicGrowableArena_next_page(arena, page)) return NULL;
+    }
+}
+
+/**
+ * Resets the arena, keeping only the active page. Large blocks and all other pages are released.
+ * Must not run concurrently with allocations.
+ * @param arena The atomic growable arena to reset
+ */
+void AtomicGrowableArena_reset(AtomicGrowableArena *arena) {
+    if (arena == NULL) return;
+    AtomicArenaPage *page = atomic_load_explicit(&arena->current, memory_order_acquire);
+    AtomicArenaPage_free_list(page->next);
+    page->next = NULL;
+    AtomicArena_reset(&page->arena);
+    atomic_store_explicit(&arena->pages, 1, memory_order_relaxed);
+
+    AtomicArenaPage_free_list(atomic_exchange_explicit(&arena->large, NULL, memory_order_acquire));
+}
+
+/**
+ * Release the memory allocated by the arena. After this call, the arena cannot be used anymore.
+ * Must not run concurrently with allocations.
+ * @param arena The arena to free.
+ */
+void AtomicGrowableArena_free(AtomicGrowableArena *arena) {
+    if (arena != NULL) {
+        AtomicArenaPage_free_list(atomic_exchange_explicit(&arena->current, NULL, memory_order_acquire));
+        AtomicArenaPage_free_list(atomic_exchange_explicit(&arena->large, NULL, memory_order_acquire));
+        atomic_store_explicit(&arena->pages, 0, memory_order_relaxed);
+    }
+}
+
+/**
+ * Returns the amount of available bytes left for allocation in the pages. Only exact when no
+ * allocations run concurrently.
+ * @param arena
+ * @return Number of bytes available.
+ */
+size_t AtomicGrowableArena_remaining(const AtomicGrowableArena *arena) {
+    if (arena == NULL) return 0;
+
+    size_t capacity = 0;
+    for (const AtomicArenaPage *page = atomic_load_explicit(&arena->current, memory_order_acquire);
+         page != NULL; page = page->next)
+        capacity += AtomicArena_remaining(&page->arena);
+
+    return capacity;
+}
+
+#endif
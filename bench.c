@@ -0,0 +1,657 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "arena.c"
+#include "atomic_arena.c"
+#include "page_pool.c"
+#include "pool.c"
+#include "slab.c"
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * Measures the cost of a GrowableArena_alloc call depending on the number of pages the arena
+ * already holds. With the active page cursor the cost should stay flat.
+ */
+void bench_growable_arena_pages(void) {
+    const size_t page_size = 64 * 1024;
+    const size_t alloc_size = 64;
+    // Time a window of 8 pages worth of allocations at each page count
+    const size_t samples = 8 * page_size / alloc_size;
+    const size_t page_counts[] = {1, 16, 256, 1024, 4096};
+
+    printf("GrowableArena_alloc, page size %zu, allocation size %zu\n", page_size, alloc_size);
+
+    GrowableArena arena = {0};
+    if (!GrowableArena_init(&arena, page_size)) {
+        fprintf(stderr, "GrowableArena_init failed\n");
+        return;
+    }
+
+    volatile char sink = 0;
+    for (size_t i = 0; i < sizeof(page_counts) / sizeof(page_counts[0]); ++i) {
+        // Grow the arena up to the desired number of pages
+        while (arena.pages < page_counts[i]) {
+            if (GrowableArena_alloc(&arena, alloc_size) == NULL) goto out;
+        }
+
+        const double start = now_ns();
+        for (size_t n = 0; n < samples; ++n) {
+            char *mem = GrowableArena_alloc(&arena, alloc_size);
+            if (mem == NULL) goto out;
+            *mem = (char)n;
+            sink += *mem;
+        }
+        const double elapsed = now_ns() - start;
+
+        printf("  pages %6zu: %6.2f ns/op\n", page_counts[i], elapsed / (double)samples);
+    }
+
+out:
+    GrowableArena_free(&arena);
+}
+
+/**
+ * Measures the cost of a small bump allocation that hits the fast path.
+ */
+void bench_fast_path(void) {
+    const size_t rounds = 2000;
+    const size_t allocs = 4096;
+    const size_t alloc_size = 16;
+
+    printf("Fast path, allocation size %zu\n", alloc_size);
+
+    Arena arena = {0};
+    GrowableArena garena = {0};
+    if (!Arena_init(&arena, allocs * alloc_size) || !GrowableArena_init(&garena, allocs * alloc_size)) {
+        fprintf(stderr, "Arena init failed\n");
+        return;
+    }
+
+    void *volatile sink;
+    double start = now_ns();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (size_t n = 0; n < allocs; ++n) sink = Arena_alloc(&arena, alloc_size);
+        Arena_reset(&arena);
+    }
+    const double arena_ns = (now_ns() - start) / (double)(rounds * allocs);
+
+    start = now_ns();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (size_t n = 0; n < allocs; ++n) sink = GrowableArena_alloc(&garena, alloc_size);
+        GrowableArena_reset(&garena);
+    }
+    const double garena_ns = (now_ns() - start) / (double)(rounds * allocs);
+
+    start = now_ns();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (size_t n = 0; n < allocs; ++n) sink = GrowableArena_alloc_aligned(&garena, alloc_size, 8);
+        GrowableArena_reset(&garena);
+    }
+    const double aligned_ns = (now_ns() - start) / (double)(rounds * allocs);
+    (void)sink;
+
+    printf("  Arena_alloc:                 %5.2f ns/op\n", arena_ns);
+    printf("  GrowableArena_alloc:         %5.2f ns/op\n", garena_ns);
+    printf("  GrowableArena_alloc_aligned: %5.2f ns/op\n", aligned_ns);
+
+    Arena_free(&arena);
+    GrowableArena_free(&garena);
+}
+
+#define CONTENTION_OPS 200000
+#define CONTENTION_SIZE 32
+
+typedef struct {
+    pthread_barrier_t *barrier;
+    AtomicGrowableArena *atomic;
+    GrowableArena *locked;
+    pthread_mutex_t *lock;
+} ContentionWorker;
+
+static void *contention_atomic_worker(void *arg) {
+    ContentionWorker *worker = arg;
+    pthread_barrier_wait(worker->barrier);
+    for (size_t n = 0; n < CONTENTION_OPS; ++n) {
+        char *mem = AtomicGrowableArena_alloc(worker->atomic, CONTENTION_SIZE);
+        if (mem == NULL) break;
+        *mem = (char)n;
+    }
+    return NULL;
+}
+
+static void *contention_locked_worker(void *arg) {
+    ContentionWorker *worker = arg;
+    pthread_barrier_wait(worker->barrier);
+    for (size_t n = 0; n < CONTENTION_OPS; ++n) {
+        pthread_mutex_lock(worker->lock);
+        char *mem = GrowableArena_alloc(worker->locked, CONTENTION_SIZE);
+        pthread_mutex_unlock(worker->lock);
+        if (mem == NULL) break;
+        *mem = (char)n;
+    }
+    return NULL;
+}
+
+/**
+ * Runs threads allocating from a single shared arena and returns the elapsed time in ns.
+ */
+static double contention_run(const size_t threads, const bool atomic) {
+    AtomicGrowableArena atomic_arena = {0};
+    GrowableArena locked_arena = {0};
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_barrier_t barrier;
+    pthread_t ids[64];
+    ContentionWorker worker = {
+        .barrier = &barrier,
+        .atomic = &atomic_arena,
+        .locked = &locked_arena,
+        .lock = &lock,
+    };
+
+    if (atomic ? !AtomicGrowableArena_init(&atomic_arena, 64 * 1024)
+               : !GrowableArena_init(&locked_arena, 64 * 1024))
+        return 0;
+    pthread_barrier_init(&barrier, NULL, (unsigned)threads + 1);
+    for (size_t i = 0; i < threads; ++i)
+        if (pthread_create(&ids[i], NULL, atomic ? contention_atomic_worker : contention_locked_worker, &worker) != 0)
+            abort();
+
+    pthread_barrier_wait(&barrier);
+    const double start = now_ns();
+    for (size_t i = 0; i < threads; ++i)
+        pthread_join(ids[i], NULL);
+    const double elapsed = now_ns() - start;
+
+    pthread_barrier_destroy(&barrier);
+    if (atomic) AtomicGrowableArena_free(&atomic_arena);
+    else GrowableArena_free(&locked_arena);
+    return elapsed;
+}
+
+/**
+ * Compares AtomicGrowableArena against a GrowableArena behind a mutex with 1 to 64 threads sharing
+ * one arena.
+ */
+void bench_contention(void) {
+    const size_t thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+
+    printf("Shared arena contention, allocation size %d, %d allocations per thread\n",
+           CONTENTION_SIZE, CONTENTION_OPS);
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i) {
+        const size_t threads = thread_counts[i];
+        const double ops = (double)(threads * CONTENTION_OPS);
+        const double atomic = contention_run(threads, true);
+        const double locked = contention_run(threads, false);
+        printf("  threads %2zu: atomic %7.2f Mops/s, mutex %7.2f Mops/s\n",
+               threads, ops / atomic * 1e3, ops / locked * 1e3);
+    }
+}
+
+/*
+ * Workload suite. Every workload runs against every allocator in a forked child, so each row gets
+ * its own peak RSS. Results are printed as a table, or with --csv / --json as one record per row.
+ * The malloc rows use whatever malloc the process has, run with LD_PRELOAD and BENCH_MALLOC to
+ * compare against jemalloc or mimalloc:
+ *
+ *   LD_PRELOAD=libjemalloc.so BENCH_MALLOC=jemalloc ./bench --csv
+ */
+
+#define SUITE_OPS 1000000       // Allocations per workload and thread
+#define SUITE_WINDOW 1024       // Live objects in the churn workloads
+#define SUITE_REPEAT 3          // Runs per row, the fastest one is reported
+#define SUITE_MAX_THREADS 8
+
+typedef enum bench_format_t {
+    BENCH_TEXT,
+    BENCH_CSV,
+    BENCH_JSON,
+} BenchFormat;
+
+/**
+ * State of the allocator under test, each allocator uses its own member.
+ */
+typedef struct bench_state_t {
+    Arena arena;
+    GrowableArena growable;
+    VirtualArena virtual_arena;
+    Pool pool;
+    Slab slab;
+    GrowableArena *thread_arena;
+    AtomicGrowableArena *shared;
+} BenchState;
+
+/**
+ * Allocator under test. Arenas release their objects with reset, the others one by one with
+ * release. An allocator with neither keeps everything until destroy.
+ */
+typedef struct bench_allocator_t {
+    const char *name;
+    size_t fixed_size;      // Only serves this size, 0 for any size
+    bool (*init)(BenchState *state);
+    void *(*alloc)(BenchState *state, size_t size);
+    void *(*realloc)(BenchState *state, void *ptr, size_t old_size, size_t new_size);
+    void (*release)(BenchState *state, void *ptr);
+    void (*reset)(BenchState *state);
+    void (*destroy)(BenchState *state);
+} BenchAllocator;
+
+static bool bench_malloc_init(BenchState *state) { (void)state; return true; }
+static void *bench_malloc_alloc(BenchState *state, size_t size) { (void)state; return malloc(size); }
+static void *bench_malloc_realloc(BenchState *state, void *ptr, size_t old_size, size_t new_size) {
+    (void)state; (void)old_size;
+    return realloc(ptr, new_size);
+}
+static void bench_malloc_release(BenchState *state, void *ptr) { (void)state; free(ptr); }
+static void bench_malloc_destroy(BenchState *state) { (void)state; }
+
+static bool bench_arena_init(BenchState *state) { return Arena_init(&state->arena, 64 * 1024 * 1024); }
+static void *bench_arena_alloc(BenchState *state, size_t size) {
+    return Arena_alloc_aligned(&state->arena, size, ARENA_DEFAULT_ALIGNMENT);
+}
+static void *bench_arena_realloc(BenchState *state, void *ptr, size_t old_size, size_t new_size) {
+    return Arena_realloc(&state->arena, ptr, old_size, new_size);
+}
+static void bench_arena_reset(BenchState *state) { Arena_reset(&state->arena); }
+static void bench_arena_destroy(BenchState *state) { Arena_free(&state->arena); }
+
+static bool bench_growable_init(BenchState *state) { return GrowableArena_init(&state->growable, 64 * 1024); }
+static void *bench_growable_alloc(BenchState *state, size_t size) {
+    return GrowableArena_alloc_aligned(&state->growable, size, ARENA_DEFAULT_ALIGNMENT);
+}
+static void *bench_growable_realloc(BenchState *state, void *ptr, size_t old_size, size_t new_size) {
+    return GrowableArena_realloc(&state->growable, ptr, old_size, new_size);
+}
+static void bench_growable_reset(BenchState *state) { GrowableArena_reset(&state->growable); }
+static void bench_growable_destroy(BenchState *state) { GrowableArena_free(&state->growable); }
+
+static bool bench_virtual_init(BenchState *state) {
+    return VirtualArena_init(&state->virtual_arena, (size_t)1 << 30, 0);
+}
+static void *bench_virtual_alloc(BenchState *state, size_t size) {
+    return VirtualArena_alloc_aligned(&state->virtual_arena, size, ARENA_DEFAULT_ALIGNMENT);
+}
+static void *bench_virtual_realloc(BenchState *state, void *ptr, size_t old_size, size_t new_size) {
+    return VirtualArena_realloc(&state->virtual_arena, ptr, old_size, new_size);
+}
+static void bench_virtual_reset(BenchState *state) { VirtualArena_reset(&state->virtual_arena); }
+static void bench_virtual_destroy(BenchState *state) { VirtualArena_free(&state->virtual_arena); }
+
+static bool bench_pool_init(BenchState *state) { return Pool_init(&state->pool, 32, 2048, 0); }
+static void *bench_pool_alloc(BenchState *state, size_t size) { (void)size; return Pool_alloc(&state->pool); }
+static void bench_pool_release(BenchState *state, void *ptr) { Pool_free(&state->pool, ptr); }
+static void bench_pool_destroy(BenchState *state) { Pool_destroy(&state->pool); }
+
+static bool bench_slab_init(BenchState *state) { return Slab_init(&state->slab); }
+static void *bench_slab_alloc(BenchState *state, size_t size) { return Slab_alloc(&state->slab, size); }
+static void bench_slab_release(BenchState *state, void *ptr) { (void)state; Slab_free(ptr); }
+static void bench_slab_destroy(BenchState *state) { Slab_destroy(&state->slab); }
+
+static PagePool bench_page_pool;
+static bool bench_page_pool_init(BenchState *state) {
+    state->thread_arena = PagePool_thread_arena(&bench_page_pool);
+    return state->thread_arena != NULL;
+}
+static void *bench_page_pool_alloc(BenchState *state, size_t size) {
+    return GrowableArena_alloc_aligned(state->thread_arena, size, ARENA_DEFAULT_ALIGNMENT);
+}
+static void bench_page_pool_reset(BenchState *state) { GrowableArena_reset(state->thread_arena); }
+static void bench_page_pool_destroy(BenchState *state) { PagePool_release_thread_arena(&bench_page_pool); (void)state; }
+
+static AtomicGrowableArena bench_shared_arena;
+static bool bench_shared_init(BenchState *state) { state->shared = &bench_shared_arena; return true; }
+static void *bench_shared_alloc(BenchState *state, size_t size) {
+    return AtomicGrowableArena_alloc_aligned(state->shared, size, ARENA_DEFAULT_ALIGNMENT);
+}
+static void bench_shared_destroy(BenchState *state) { (void)state; }
+
+static BenchAllocator bench_allocators[] = {
+    { "malloc", 0, bench_malloc_init, bench_malloc_alloc, bench_malloc_realloc, bench_malloc_release, NULL, bench_malloc_destroy },
+    { "Arena", 0, bench_arena_init, bench_arena_alloc, bench_arena_realloc, NULL, bench_arena_reset, bench_arena_destroy },
+    { "GrowableArena", 0, bench_growable_init, bench_growable_alloc, bench_growable_realloc, NULL, bench_growable_reset, bench_growable_destroy },
+    { "VirtualArena", 0, bench_virtual_init, bench_virtual_alloc, bench_virtual_realloc, NULL, bench_virtual_reset, bench_virtual_destroy },
+    { "Pool", 32, bench_pool_init, bench_pool_alloc, NULL, bench_pool_release, NULL, bench_pool_destroy },
+    { "Slab", 0, bench_slab_init, bench_slab_alloc, NULL, bench_slab_release, NULL, bench_slab_destroy },
+};
+
+static BenchAllocator bench_thread_allocators[] = {
+    { "malloc", 0, bench_malloc_init, bench_malloc_alloc, NULL, bench_malloc_release, NULL, bench_malloc_destroy },
+    { "GrowableArena", 0, bench_growable_init, bench_growable_alloc, NULL, NULL, bench_growable_reset, bench_growable_destroy },
+    { "PagePool", 0, bench_page_pool_init, bench_page_pool_alloc, NULL, NULL, bench_page_pool_reset, bench_page_pool_destroy },
+    { "Slab", 0, bench_slab_init, bench_slab_alloc, NULL, bench_slab_release, NULL, bench_slab_destroy },
+    { "AtomicGrowableArena", 0, bench_shared_init, bench_shared_alloc, NULL, NULL, NULL, bench_shared_destroy },
+};
+
+/**
+ * Deterministic size sequence, xorshift so every run sees the same requests.
+ */
+static inline uint32_t bench_random(uint32_t *seed) {
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *seed = x;
+}
+
+/**
+ * Mostly small requests with a tail of bigger ones: 16 to 64 bytes 80% of the time, up to 1 KiB
+ * 18% and up to 16 KiB 2%.
+ */
+static inline size_t bench_mixed_size(uint32_t *seed) {
+    const uint32_t r = bench_random(seed);
+    const uint32_t bucket = r % 100;
+    if (bucket < 80) return 16 + (r >> 8) % 49;
+    if (bucket < 98) return 64 + (r >> 8) % 961;
+    return 1024 + (r >> 8) % (15 * 1024 + 1);
+}
+
+/**
+ * Allocate objects in windows of SUITE_WINDOW live objects. Arenas reset after every window,
+ * the other allocators release the object whose slot is reused.
+ * @return No. of allocations or 0 if an allocation failed
+ */
+static size_t bench_churn(const BenchAllocator *allocator, BenchState *state, const bool mixed) {
+    void *window[SUITE_WINDOW] = {0};
+    uint32_t seed = 2463534242u;
+    for (size_t n = 0; n < SUITE_OPS; n += SUITE_WINDOW) {
+        for (size_t i = 0; i < SUITE_WINDOW; ++i) {
+            if (allocator->release != NULL && window[i] != NULL) allocator->release(state, window[i]);
+            const size_t size = mixed ? bench_mixed_size(&seed) : 32;
+            char *mem = allocator->alloc(state, size);
+            if (mem == NULL) return 0;
+            mem[0] = (char)i;
+            mem[size - 1] = (char)i;
+            window[i] = mem;
+        }
+        if (allocator->reset != NULL) allocator->reset(state);
+    }
+    if (allocator->release != NULL)
+        for (size_t i = 0; i < SUITE_WINDOW; ++i) allocator->release(state, window[i]);
+    return SUITE_OPS;
+}
+
+static size_t bench_small_churn(const BenchAllocator *allocator, BenchState *state) {
+    return bench_churn(allocator, state, false);
+}
+
+static size_t bench_mixed_churn(const BenchAllocator *allocator, BenchState *state) {
+    return bench_churn(allocator, state, true);
+}
+
+/**
+ * Allocate blocks of 16 to 256 KiB in windows of 32 live objects, released like bench_churn.
+ * @return No. of allocations or 0 if an allocation failed
+ */
+static size_t bench_large_churn(const BenchAllocator *allocator, BenchState *state) {
+    void *window[32] = {0};
+    uint32_t seed = 2463534242u;
+    for (size_t n = 0; n < SUITE_OPS / 10; n += 32) {
+        for (size_t i = 0; i < 32; ++i) {
+            if (allocator->release != NULL && window[i] != NULL) allocator->release(state, window[i]);
+            const size_t size = 16 * 1024 + bench_random(&seed) % (240 * 1024 + 1);
+            char *mem = allocator->alloc(state, size);
+            if (mem == NULL) return 0;
+            mem[0] = (char)i;
+            mem[size - 1] = (char)i;
+            window[i] = mem;
+        }
+        if (allocator->reset != NULL) allocator->reset(state);
+    }
+    if (allocator->release != NULL)
+        for (size_t i = 0; i < 32; ++i) allocator->release(state, window[i]);
+    return SUITE_OPS / 10;
+}
+
+/**
+ * Build 64 KiB buffers by appending 16 bytes at a time through realloc.
+ * @return No. of appends or 0 if an allocation failed
+ */
+static size_t bench_realloc_append(const BenchAllocator *allocator, BenchState *state) {
+    const size_t step = 16, limit = 64 * 1024;
+    size_t ops = 0;
+    while (ops < SUITE_OPS) {
+        char *buffer = NULL;
+        for (size_t size = 0; size < limit; size += step) {
+            buffer = allocator->realloc(state, buffer, size, size + step);
+            if (buffer == NULL) return 0;
+            memset(buffer + size, (int)size, step);
+            ops++;
+        }
+        if (allocator->release != NULL) allocator->release(state, buffer);
+        if (allocator->reset != NULL) allocator->reset(state);
+    }
+    return ops;
+}
+
+/**
+ * Allocate 256 objects of 64 bytes, release them all, repeat. This is the request lifetime pattern
+ * arenas are made for.
+ * @return No. of allocations or 0 if an allocation failed
+ */
+static size_t bench_reset_cycles(const BenchAllocator *allocator, BenchState *state) {
+    void *objects[256];
+    for (size_t n = 0; n < SUITE_OPS; n += 256) {
+        for (size_t i = 0; i < 256; ++i) {
+            char *mem = allocator->alloc(state, 64);
+            if (mem == NULL) return 0;
+            mem[0] = (char)i;
+            objects[i] = mem;
+        }
+        if (allocator->release != NULL)
+            for (size_t i = 0; i < 256; ++i) allocator->release(state, objects[i]);
+        if (allocator->reset != NULL) allocator->reset(state);
+    }
+    return SUITE_OPS;
+}
+
+typedef struct bench_workload_t {
+    const char *name;
+    size_t (*run)(const BenchAllocator *allocator, BenchState *state);
+    bool fixed_size;        // Only requests objects of 32 bytes
+    bool realloc;           // Needs realloc
+} BenchWorkload;
+
+static const BenchWorkload bench_workloads[] = {
+    { "small-churn", bench_small_churn, true, false },
+    { "mixed-churn", bench_mixed_churn, false, false },
+    { "large-churn", bench_large_churn, false, false },
+    { "realloc-append", bench_realloc_append, false, true },
+    { "reset-cycles", bench_reset_cycles, false, false },
+};
+
+/**
+ * Outcome of a row, sent from the child to the parent.
+ */
+typedef struct bench_result_t {
+    size_t ops;
+    double ns;
+} BenchResult;
+
+typedef struct bench_thread_t {
+    const BenchAllocator *allocator;
+    pthread_barrier_t *barrier;
+    size_t ops;
+    double start;
+    double end;
+} BenchThread;
+
+static void *bench_thread_worker(void *arg) {
+    BenchThread *thread = arg;
+    BenchState state = {0};
+    if (!thread->allocator->init(&state)) {
+        pthread_barrier_wait(thread->barrier);
+        return NULL;
+    }
+    pthread_barrier_wait(thread->barrier);
+    thread->start = now_ns();
+    thread->ops = bench_small_churn(thread->allocator, &state);
+    thread->end = now_ns();
+    thread->allocator->destroy(&state);
+    return NULL;
+}
+
+/**
+ * Run the small object churn on threads, each thread with its own allocator state.
+ */
+static BenchResult bench_run_threads(const BenchAllocator *allocator, const size_t threads) {
+    BenchResult result = {0};
+    pthread_t ids[SUITE_MAX_THREADS];
+    BenchThread workers[SUITE_MAX_THREADS];
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, (unsigned)threads + 1);
+    for (size_t i = 0; i < threads; ++i) {
+        workers[i] = (BenchThread){ .allocator = allocator, .barrier = &barrier };
+        if (pthread_create(&ids[i], NULL, bench_thread_worker, &workers[i]) != 0) abort();
+    }
+    pthread_barrier_wait(&barrier);
+    for (size_t i = 0; i < threads; ++i) pthread_join(ids[i], NULL);
+    pthread_barrier_destroy(&barrier);
+
+    // Timed by the workers, from the first start to the last end
+    double start = workers[0].start, end = workers[0].end;
+    for (size_t i = 0; i < threads; ++i) {
+        if (workers[i].ops == 0) return (BenchResult){0};
+        result.ops += workers[i].ops;
+        if (workers[i].start < start) start = workers[i].start;
+        if (workers[i].end > end) end = workers[i].end;
+    }
+    result.ns = end - start;
+    return result;
+}
+
+/**
+ * Run a row: the fastest of SUITE_REPEAT runs, each on a fresh allocator.
+ */
+static BenchResult bench_run(const BenchWorkload *workload, const BenchAllocator *allocator, const size_t threads) {
+    BenchResult best = {0};
+    for (size_t r = 0; r < SUITE_REPEAT; ++r) {
+        BenchResult result = {0};
+        if (workload == NULL) {
+            if (!PagePool_init(&bench_page_pool, 64 * 1024, 4) ||
+                !AtomicGrowableArena_init(&bench_shared_arena, 64 * 1024))
+                return best;
+            result = bench_run_threads(allocator, threads);
+            AtomicGrowableArena_free(&bench_shared_arena);
+            PagePool_free(&bench_page_pool);
+        } else {
+            BenchState state = {0};
+            if (!allocator->init(&state)) return best;
+            const double start = now_ns();
+            result.ops = workload->run(allocator, &state);
+            result.ns = now_ns() - start;
+            allocator->destroy(&state);
+        }
+        if (result.ops == 0) return (BenchResult){0};
+        if (best.ops == 0 || result.ns < best.ns) best = result;
+    }
+    return best;
+}
+
+static void bench_report(const BenchFormat format, const char *workload, const char *allocator,
+                         const size_t threads, const BenchResult *result, const long rss_kib) {
+    const double ns_per_op = result->ops ? result->ns * (double)threads / (double)result->ops : 0.0;
+    const double mops = result->ns > 0 ? (double)result->ops / result->ns * 1e3 : 0.0;
+    switch (format) {
+        case BENCH_TEXT:
+            if (result->ops == 0) printf("  %-15s %-20s %2zu  failed\n", workload, allocator, threads);
+            else printf("  %-15s %-20s %2zu  %8.2f ns/op  %8.2f Mops/s  %8ld KiB\n",
+                        workload, allocator, threads, ns_per_op, mops, rss_kib);
+            break;
+        case BENCH_CSV:
+            printf("%s,%s,%zu,%zu,%.3f,%.3f,%ld\n", workload, allocator, threads, result->ops, ns_per_op, mops, rss_kib);
+            break;
+        case BENCH_JSON:
+            printf("{\"workload\":\"%s\",\"allocator\":\"%s\",\"threads\":%zu,\"ops\":%zu,"
+                   "\"ns_per_op\":%.3f,\"mops_per_s\":%.3f,\"peak_rss_kib\":%ld}\n",
+                   workload, allocator, threads, result->ops, ns_per_op, mops, rss_kib);
+            break;
+    }
+    fflush(stdout);
+}
+
+/**
+ * Run a row in a forked child and report it with the peak RSS of the child.
+ */
+static void bench_row(const BenchFormat format, const BenchWorkload *workload,
+                      const BenchAllocator *allocator, const size_t threads) {
+    const char *name = allocator->name;
+    if (allocator->init == bench_malloc_init && getenv("BENCH_MALLOC") != NULL) name = getenv("BENCH_MALLOC");
+
+    int fds[2];
+    if (pipe(fds) != 0) return;
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid < 0) return;
+    if (pid == 0) {
+        close(fds[0]);
+        const BenchResult result = bench_run(workload, allocator, threads);
+        const ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == (ssize_t)sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    BenchResult result = {0};
+    if (read(fds[0], &result, sizeof(result)) != (ssize_t)sizeof(result)) result = (BenchResult){0};
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage = {0};
+    wait4(pid, &status, 0, &usage);
+    bench_report(format, workload != NULL ? workload->name : "threaded-churn", name, threads, &result, usage.ru_maxrss);
+}
+
+/**
+ * Runs every workload against every allocator, then the small object churn on 1 to
+ * SUITE_MAX_THREADS threads.
+ */
+void bench_suite(const BenchFormat format) {
+    if (format == BENCH_TEXT) printf("Workloads, %d operations per workload and thread\n", SUITE_OPS);
+    if (format == BENCH_CSV) printf("workload,allocator,threads,ops,ns_per_op,mops_per_s,peak_rss_kib\n");
+
+    for (size_t w = 0; w < sizeof(bench_workloads) / sizeof(bench_workloads[0]); ++w) {
+        const BenchWorkload *workload = &bench_workloads[w];
+        for (size_t a = 0; a < sizeof(bench_allocators) / sizeof(bench_allocators[0]); ++a) {
+            const BenchAllocator *allocator = &bench_allocators[a];
+            if (allocator->fixed_size != 0 && !workload->fixed_size) continue;
+            if (workload->realloc && allocator->realloc == NULL) continue;
+            bench_row(format, workload, allocator, 1);
+        }
+    }
+
+    for (size_t threads = 1; threads <= SUITE_MAX_THREADS; threads *= 2)
+        for (size_t a = 0; a < sizeof(bench_thread_allocators) / sizeof(bench_thread_allocators[0]); ++a)
+            bench_row(format, NULL, &bench_thread_allocators[a], threads);
+}
+
+/**
+ * Usage: bench [--csv | --json]. The micro benchmarks only run with the default text output.
+ */
+int main(int argc, char **argv) {
+    BenchFormat format = BENCH_TEXT;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--csv") == 0) format = BENCH_CSV;
+        else if (strcmp(argv[i], "--json") == 0) format = BENCH_JSON;
+        else {
+            fprintf(stderr, "usage: %s [--csv | --json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (format == BENCH_TEXT) {
+        bench_fast_path();
+        bench_growable_arena_pages();
+        bench_contention();
+    }
+    bench_suite(format);
+
+    return 0;
+}
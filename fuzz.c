@@ -0,0 +1,897 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "arena.c"
+#include "atomic_arena.c"
+#include "page_pool.c"
+#include "pool.c"
+#include "slab.c"
+
+/**
+ * Randomised stress and fuzz harness, runs operation sequences against every arena variant and
+ * the Pool and Slab allocators on top of them, and checks them against a reference model.
+ *
+ * An input is a byte string decoded into a sequence of alloc, aligned alloc, batch alloc, realloc,
+ * mark, rewind, reset and free/init operations. Pool and Slab decode it into alloc, free of a live
+ * block, reset and free/init operations instead. The model keeps the live allocations, each filled
+ * with its own byte pattern, and the marks with the allocations they cover. It checks that:
+ *
+ * - allocations are aligned and do not overlap any live allocation, also when a freed block of a
+ *   Pool or Slab is handed out again
+ * - allocations only fail when a fixed capacity arena is out of room
+ * - realloc keeps the contents, rewind and reset keep everything the model still holds
+ * - rewind and reset give back the room the arena had at the mark, resp. after init
+ * - a child arena hands its block back to the parent on free
+ *
+ * Built with -fsanitize=fuzzer and -DARENA_LIBFUZZER, LLVMFuzzerTestOneInput is the libFuzzer
+ * entry point. Otherwise main runs random inputs and a threaded stress of the atomic arenas and of
+ * per-thread arenas on a shared PagePool, with ARENA_TRACE also of the shared ring of events:
+ *
+ *     ./fuzz [iterations [seed]]   random inputs, the seed is printed to reproduce a failure
+ *     ./fuzz file...               replay inputs, e.g. a crash found by libFuzzer
+ */
+
+#define FUZZ_MAX_LIVE 1024          // Allocations the model tracks, more are not recorded
+#define FUZZ_MAX_MARKS 16
+#define FUZZ_VERIFY_INTERVAL 32     // Ops between checks of the live allocations
+#define FUZZ_INPUT_SIZE 4096        // Most bytes of a random input
+#define FUZZ_PATTERN_PERIOD 4093
+#define FUZZ_THREADS 4
+#define FUZZ_THREAD_ALLOCS 2000
+
+/**
+ * The arena variants and allocators every input runs against.
+ */
+typedef enum fuzz_kind_t {
+    FUZZ_ARENA,                     // Arena, fixed capacity
+    FUZZ_CHILD_ARENA,               // Arena carved from a GrowableArena with Arena_init_child
+    FUZZ_GROWABLE,                  // GrowableArena, fixed page size
+    FUZZ_GROWABLE_DOUBLE,           // GrowableArena, doubling pages, reset keeps two of them
+    FUZZ_GROWABLE_ON_PARENT,        // GrowableArena drawing from a parent, GrowableArena_allocator
+    FUZZ_GROWABLE_POOL,             // GrowableArena on a shared PagePool
+    FUZZ_VIRTUAL,                   // VirtualArena, decommits on reset
+    FUZZ_POOL,                      // Pool, object size and cache alignment vary on init
+    FUZZ_SLAB,                      // Slab, blocks of all size classes and large spans
+    FUZZ_KINDS,
+} FuzzKind;
+
+static const char *const Fuzz_kind_names[FUZZ_KINDS] = {
+    "Arena", "child Arena", "GrowableArena", "GrowableArena (doubling)", "GrowableArena (on parent)",
+    "GrowableArena (PagePool)", "VirtualArena", "Pool", "Slab",
+};
+
+/**
+ * An arena under test, only the members of its kind are used.
+ */
+typedef struct fuzz_target_t {
+    FuzzKind kind;
+    Arena arena;
+    GrowableArena growable;
+    GrowableArena parent;
+    ArenaAllocator from_parent;
+    VirtualArena virtual;
+    Pool pool;
+    size_t object_size;             // Object size of the pool
+    Slab slab;
+    size_t initial_remaining;       // Room after init
+    size_t parent_remaining;        // Room of the parent before the child was carved
+} FuzzTarget;
+
+typedef union fuzz_mark_t {
+    ArenaMark arena;
+    GrowableArenaMark growable;
+} FuzzMark;
+
+typedef struct fuzz_allocation_t {
+    unsigned char *ptr;
+    size_t size;
+    uint8_t seed;
+} FuzzAllocation;
+
+typedef struct fuzz_mark_entry_t {
+    FuzzMark mark;
+    size_t live;                    // No. of live allocations when the mark was taken
+    size_t remaining;               // Room when the mark was taken
+} FuzzMarkEntry;
+
+/**
+ * The reference model of one run.
+ */
+typedef struct fuzz_model_t {
+    const char *name;
+    size_t op;                      // No. of the current operation, for failure messages
+    uint8_t seed;
+    FuzzAllocation live[FUZZ_MAX_LIVE];
+    size_t count;
+    FuzzMarkEntry marks[FUZZ_MAX_MARKS];
+    size_t marks_count;
+} FuzzModel;
+
+typedef struct fuzz_input_t {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+} FuzzInput;
+
+static PagePool Fuzz_pool;
+static pthread_once_t Fuzz_pool_once = PTHREAD_ONCE_INIT;
+
+static void Fuzz_pool_init(void) {
+    if (!PagePool_init(&Fuzz_pool, 4096, 2)) abort();
+}
+
+/**
+ * Report a failed check and abort, so libFuzzer and the sanitizers keep the input.
+ */
+#define FUZZ_CHECK(model, cond, message)                                                          \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            fprintf(stderr, "%s, op %zu: %s (%s)\n", (model)->name, (model)->op, message, #cond);  \
+            abort();                                                                               \
+        }                                                                                          \
+    } while (0)
+
+/**
+ * Next byte of the input, 0 once it is exhausted.
+ */
+static uint8_t FuzzInput_byte(FuzzInput *input) {
+    return input->pos < input->size ? input->data[input->pos++] : 0;
+}
+
+/**
+ * Decode an allocation size: mostly small objects, some up to a page, a few large blocks.
+ */
+static size_t FuzzInput_size(FuzzInput *input) {
+    const uint8_t range = FuzzInput_byte(input);
+    if (range < 160) return range % 64;
+    const size_t wide = (size_t)FuzzInput_byte(input) << 8 | FuzzInput_byte(input);
+    if (range < 240) return wide % 4096;
+    return wide * 4;
+}
+
+/**
+ * Decode an alignment: mostly up to 16, sometimes up to ARENA_MAX_ALIGNMENT.
+ */
+static size_t FuzzInput_alignment(FuzzInput *input) {
+    const uint8_t exponent = FuzzInput_byte(input);
+    return (size_t)1 << (exponent < 192 ? exponent % 5 : exponent % 13);
+}
+
+/**
+ * Allocations are filled with a pattern of period FUZZ_PATTERN_PERIOD, starting at their seed. The
+ * period is prime, so bytes copied to a shifted offset do not match, and filling and checking are
+ * memcpy and memcmp from the table.
+ */
+static uint8_t Fuzz_pattern[2 * FUZZ_PATTERN_PERIOD];
+static pthread_once_t Fuzz_pattern_once = PTHREAD_ONCE_INIT;
+
+static void Fuzz_pattern_init(void) {
+    for (size_t i = 0; i < sizeof(Fuzz_pattern); ++i) {
+        const size_t k = i % FUZZ_PATTERN_PERIOD;
+        Fuzz_pattern[i] = (uint8_t)(k * 0x9D ^ k >> 5);
+    }
+}
+
+static void Fuzz_fill(const FuzzAllocation *allocation) {
+    for (size_t i = 0; i < allocation->size; i += FUZZ_PATTERN_PERIOD) {
+        const size_t count = allocation->size - i < FUZZ_PATTERN_PERIOD ? allocation->size - i : FUZZ_PATTERN_PERIOD;
+        memcpy(allocation->ptr + i, Fuzz_pattern + allocation->seed, count);
+    }
+}
+
+/**
+ * Compare bytes from up to end of an allocation with its pattern.
+ */
+static bool Fuzz_intact_range(const FuzzAllocation *allocation, size_t from, const size_t end) {
+    while (from < end) {
+        const size_t start = (allocation->seed + from) % FUZZ_PATTERN_PERIOD;
+        const size_t count = end - from < FUZZ_PATTERN_PERIOD ? end - from : FUZZ_PATTERN_PERIOD;
+        if (memcmp(allocation->ptr + from, Fuzz_pattern + start, count) != 0) return false;
+        from += count;
+    }
+    return true;
+}
+
+/**
+ * Compare the first size bytes of an allocation with its pattern.
+ */
+static bool Fuzz_intact(const FuzzAllocation *allocation, const size_t size) {
+    return Fuzz_intact_range(allocation, 0, size);
+}
+
+static bool Fuzz_is_arena(const FuzzKind kind) {
+    return kind == FUZZ_ARENA || kind == FUZZ_CHILD_ARENA;
+}
+
+static bool Fuzz_is_growable(const FuzzKind kind) {
+    return kind == FUZZ_GROWABLE || kind == FUZZ_GROWABLE_DOUBLE || kind == FUZZ_GROWABLE_ON_PARENT ||
+           kind == FUZZ_GROWABLE_POOL;
+}
+
+/**
+ * Whether blocks are freed one by one, Pool and Slab have no marks and no realloc.
+ */
+static bool Fuzz_is_free_list(const FuzzKind kind) {
+    return kind == FUZZ_POOL || kind == FUZZ_SLAB;
+}
+
+/**
+ * Whether the variant has a fixed capacity, allocations of the others must not fail.
+ */
+static bool Fuzz_is_bounded(const FuzzKind kind) {
+    return !Fuzz_is_growable(kind) && !Fuzz_is_free_list(kind);
+}
+
+static bool FuzzTarget_init(FuzzTarget *target, const FuzzKind kind, const size_t variation) {
+    target->kind = kind;
+    bool ok = false;
+    switch (kind) {
+        case FUZZ_ARENA:
+            ok = Arena_init(&target->arena, 64 * 1024);
+            break;
+        case FUZZ_CHILD_ARENA:
+            // Something in front of the child, so handing the block back has to rewind to a non-zero
+            // offset
+            if (!GrowableArena_init(&target->parent, 256 * 1024)) return false;
+            if (GrowableArena_alloc(&target->parent, 1 + variation % 100) == NULL) return false;
+            target->parent_remaining = GrowableArena_remaining(&target->parent);
+            ok = Arena_init_child(&target->arena, &target->parent, 48 * 1024);
+            break;
+        case FUZZ_GROWABLE:
+            ok = GrowableArena_init(&target->growable, 4096);
+            break;
+        case FUZZ_GROWABLE_DOUBLE: {
+            const GrowableArenaOptions options = {
+                .page_size = 1024,
+                .growth = ARENA_GROWTH_DOUBLE,
+                .max_page_size = 64 * 1024,
+                .retain_pages = 2,
+            };
+            ok = GrowableArena_init_with_options(&target->growable, &options);
+            break;
+        }
+        case FUZZ_GROWABLE_ON_PARENT: {
+            if (!GrowableArena_init(&target->parent, 64 * 1024)) return false;
+            target->from_parent = GrowableArena_allocator(&target->parent);
+            const GrowableArenaOptions options = { .page_size = 4096, .allocator = &target->from_parent };
+            ok = GrowableArena_init_with_options(&target->growable, &options);
+            break;
+        }
+        case FUZZ_GROWABLE_POOL:
+            pthread_once(&Fuzz_pool_once, Fuzz_pool_init);
+            ok = PagePool_init_arena(&Fuzz_pool, &target->growable);
+            break;
+        case FUZZ_VIRTUAL:
+            ok = VirtualArena_init(&target->virtual, 64 * 1024 * 1024, VIRTUAL_ARENA_DECOMMIT_ON_RESET);
+            break;
+        case FUZZ_POOL:
+            target->object_size = 1 + variation % 200;
+            ok = Pool_init(&target->pool, target->object_size, 32, variation % 3 == 0 ? POOL_CACHE_ALIGNED : 0);
+            break;
+        case FUZZ_SLAB:
+            ok = Slab_init(&target->slab);
+            break;
+        case FUZZ_KINDS:
+            break;
+    }
+    return ok;
+}
+
+/**
+ * Free the arena under test.
+ * @return false if a child arena did not hand its block back to the parent
+ */
+static bool FuzzTarget_free(FuzzTarget *target) {
+    bool ok = true;
+    switch (target->kind) {
+        case FUZZ_ARENA:
+            Arena_free(&target->arena);
+            break;
+        case FUZZ_CHILD_ARENA:
+            Arena_free(&target->arena);
+            ok = GrowableArena_remaining(&target->parent) == target->parent_remaining;
+            GrowableArena_free(&target->parent);
+            break;
+        case FUZZ_GROWABLE:
+        case FUZZ_GROWABLE_DOUBLE:
+        case FUZZ_GROWABLE_POOL:
+            GrowableArena_free(&target->growable);
+            break;
+        case FUZZ_GROWABLE_ON_PARENT:
+            GrowableArena_free(&target->growable);
+            GrowableArena_free(&target->parent);
+            break;
+        case FUZZ_VIRTUAL:
+            VirtualArena_free(&target->virtual);
+            break;
+        case FUZZ_POOL:
+            Pool_destroy(&target->pool);
+            break;
+        case FUZZ_SLAB:
+            Slab_destroy(&target->slab);
+            break;
+        case FUZZ_KINDS:
+            break;
+    }
+    return ok;
+}
+
+/**
+ * Allocate from the arena under test.
+ * @param alignment 0 for the unaligned _alloc, else a power of two for _alloc_aligned
+ */
+static void *FuzzTarget_alloc(FuzzTarget *target, const size_t size, const size_t alignment) {
+    if (Fuzz_is_arena(target->kind))
+        return alignment == 0 ? Arena_alloc(&target->arena, size) : Arena_alloc_aligned(&target->arena, size, alignment);
+    if (Fuzz_is_growable(target->kind))
+        return alignment == 0 ? GrowableArena_alloc(&target->growable, size)
+                              : GrowableArena_alloc_aligned(&target->growable, size, alignment);
+    return alignment == 0 ? VirtualArena_alloc(&target->virtual, size)
+                          : VirtualArena_alloc_aligned(&target->virtual, size, alignment);
+}
+
+static void *FuzzTarget_realloc(FuzzTarget *target, void *ptr, const size_t old_size, const size_t new_size) {
+    if (Fuzz_is_arena(target->kind)) return Arena_realloc(&target->arena, ptr, old_size, new_size);
+    if (Fuzz_is_growable(target->kind)) return GrowableArena_realloc(&target->growable, ptr, old_size, new_size);
+    return VirtualArena_realloc(&target->virtual, ptr, old_size, new_size);
+}
+
+static FuzzMark FuzzTarget_mark(const FuzzTarget *target) {
+    FuzzMark mark = {0};
+    if (Fuzz_is_arena(target->kind)) mark.arena = Arena_mark(&target->arena);
+    else if (Fuzz_is_growable(target->kind)) mark.growable = GrowableArena_mark(&target->growable);
+    else mark.arena = VirtualArena_mark(&target->virtual);
+    return mark;
+}
+
+static void FuzzTarget_rewind(FuzzTarget *target, const FuzzMark mark) {
+    if (Fuzz_is_arena(target->kind)) Arena_rewind(&target->arena, mark.arena);
+    else if (Fuzz_is_growable(target->kind)) GrowableArena_rewind(&target->growable, mark.growable);
+    else VirtualArena_rewind(&target->virtual, mark.arena);
+}
+
+static void FuzzTarget_reset(FuzzTarget *target) {
+    if (target->kind == FUZZ_POOL) Pool_reset(&target->pool);
+    else if (target->kind == FUZZ_SLAB) Slab_reset(&target->slab);
+    else if (Fuzz_is_arena(target->kind)) Arena_reset(&target->arena);
+    else if (Fuzz_is_growable(target->kind)) GrowableArena_reset(&target->growable);
+    else VirtualArena_reset(&target->virtual);
+}
+
+/**
+ * Room left in the arena under test, 0 for Pool and Slab.
+ */
+static size_t FuzzTarget_remaining(const FuzzTarget *target) {
+    if (Fuzz_is_free_list(target->kind)) return 0;
+    if (Fuzz_is_arena(target->kind)) return Arena_remaining(&target->arena);
+    if (Fuzz_is_growable(target->kind)) return GrowableArena_remaining(&target->growable);
+    return VirtualArena_remaining(&target->virtual);
+}
+
+/**
+ * Check that every live allocation still holds its pattern.
+ * @param model The model
+ * @param full false to only check the first and last bytes, where neighbouring writes land
+ */
+static void FuzzModel_verify(const FuzzModel *model, const bool full) {
+    for (size_t i = 0; i < model->count; ++i) {
+        const FuzzAllocation *allocation = &model->live[i];
+        bool intact;
+        if (full || allocation->size <= 64) {
+            intact = Fuzz_intact(allocation, allocation->size);
+        } else {
+            intact = Fuzz_intact(allocation, 32) && Fuzz_intact_range(allocation, allocation->size - 32, allocation->size);
+        }
+        FUZZ_CHECK(model, intact, "live allocation was overwritten");
+    }
+}
+
+/**
+ * Check a new block against the live allocations, except the one at skip.
+ */
+static void FuzzModel_check_block(const FuzzModel *model, const unsigned char *ptr, const size_t size,
+                                  const size_t alignment, const size_t skip) {
+    FUZZ_CHECK(model, (uintptr_t)ptr % alignment == 0, "misaligned allocation");
+    if (size == 0) return;
+    for (size_t i = 0; i < model->count; ++i) {
+        const FuzzAllocation *other = &model->live[i];
+        if (i == skip || other->size == 0) continue;
+        FUZZ_CHECK(model, ptr + size <= other->ptr || other->ptr + other->size <= ptr,
+                   "allocation overlaps a live allocation");
+    }
+}
+
+/**
+ * Record and fill a new allocation.
+ */
+static void FuzzModel_add(FuzzModel *model, unsigned char *ptr, const size_t size) {
+    if (model->count == FUZZ_MAX_LIVE) return;
+    FuzzAllocation *allocation = &model->live[model->count++];
+    *allocation = (FuzzAllocation){ .ptr = ptr, .size = size, .seed = model->seed++ };
+    Fuzz_fill(allocation);
+}
+
+/**
+ * A failed allocation is only allowed when a fixed capacity arena cannot fit the request. With
+ * debug headers and red zones the exact room is not known, then any failure of those is accepted.
+ */
+static void FuzzModel_check_failure(const FuzzModel *model, const FuzzKind kind, const size_t size,
+                                    const size_t alignment, const size_t remaining) {
+    FUZZ_CHECK(model, Fuzz_is_bounded(kind), "allocation failed");
+    FUZZ_CHECK(model, ARENA_ALLOC_OVERHEAD != 0 || size > remaining || alignment - 1 > remaining - size,
+               "allocation failed although it fits");
+}
+
+static void Fuzz_alloc(FuzzModel *model, FuzzTarget *target, const size_t size, const size_t alignment) {
+    const size_t remaining = FuzzTarget_remaining(target);
+    unsigned char *ptr = FuzzTarget_alloc(target, size, alignment);
+#ifdef ARENA_ALIGN_BY_DEFAULT
+    const size_t expected = alignment == 0 ? ARENA_DEFAULT_ALIGNMENT : alignment;
+#else
+    const size_t expected = alignment == 0 ? 1 : alignment;
+#endif
+    if (ptr == NULL) {
+        FuzzModel_check_failure(model, target->kind, size, expected, remaining);
+        return;
+    }
+    FuzzModel_check_block(model, ptr, size, expected, SIZE_MAX);
+    FuzzModel_add(model, ptr, size);
+}
+
+static void Fuzz_alloc_batch(FuzzModel *model, FuzzTarget *target, FuzzInput *input) {
+    const size_t count = 1 + FuzzInput_byte(input) % 64;
+    const size_t size = 1 + FuzzInput_size(input) % 512;
+    const size_t alignment = FuzzInput_alignment(input);
+    size_t got;
+    unsigned char *ptr = GrowableArena_alloc_batch(&target->growable, count, size, alignment, &got);
+    FUZZ_CHECK(model, ptr != NULL, "batch allocation failed");
+    FUZZ_CHECK(model, got >= 1 && got <= count, "batch allocated a wrong no. of objects");
+    FuzzModel_check_block(model, ptr, got * size, alignment, SIZE_MAX);
+    FuzzModel_add(model, ptr, got * size);
+}
+
+/**
+ * Resize a live allocation, the most recent one half of the time. Only allocations made after the
+ * newest mark are resized, growing an older one in place would reach into memory the mark covers.
+ */
+static void Fuzz_realloc(FuzzModel *model, FuzzTarget *target, FuzzInput *input) {
+    const uint8_t choice = FuzzInput_byte(input);
+    const size_t new_size = FuzzInput_size(input);
+    const size_t floor = model->marks_count > 0 ? model->marks[model->marks_count - 1].live : 0;
+    if (model->count <= floor || model->count == FUZZ_MAX_LIVE) return;
+    const size_t index = choice & 1 ? model->count - 1 : floor + choice / 2 % (model->count - floor);
+
+    FuzzAllocation *allocation = &model->live[index];
+    const size_t remaining = FuzzTarget_remaining(target);
+    unsigned char *ptr = FuzzTarget_realloc(target, allocation->ptr, allocation->size, new_size);
+    if (ptr == NULL) {
+        FuzzModel_check_failure(model, target->kind, new_size, ARENA_DEFAULT_ALIGNMENT, remaining);
+        return;
+    }
+
+    FuzzAllocation moved = { .ptr = ptr, .size = new_size, .seed = allocation->seed };
+    const size_t kept = allocation->size < new_size ? allocation->size : new_size;
+    FUZZ_CHECK(model, Fuzz_intact(&moved, kept), "realloc lost the contents");
+    FuzzModel_check_block(model, ptr, new_size, ptr == allocation->ptr ? 1 : ARENA_DEFAULT_ALIGNMENT, index);
+    moved.seed = model->seed++;
+    Fuzz_fill(&moved);
+    *allocation = moved;
+}
+
+/**
+ * Allocate an object of the pool, or a block of the slab, a few of them bigger than the spans the
+ * slab keeps for reuse.
+ */
+static void Fuzz_alloc_object(FuzzModel *model, FuzzTarget *target, FuzzInput *input) {
+    unsigned char *ptr;
+    size_t size, alignment = ARENA_DEFAULT_ALIGNMENT;
+    if (target->kind == FUZZ_POOL) {
+        ptr = Pool_alloc(&target->pool);
+        size = target->object_size;
+        alignment = target->pool.alignment;
+    } else {
+        // One in eight gets a large span, mostly of a single SLAB_SPAN so freed spans are reused
+        size = FuzzInput_size(input);
+        const uint8_t large = FuzzInput_byte(input);
+        if (large == 255) size += SLAB_CACHED_SPANS * SLAB_SPAN;
+        else if (large >= 224) size += SLAB_MAX_SIZE;
+        ptr = Slab_alloc(&target->slab, size);
+        FUZZ_CHECK(model, ptr == NULL || Slab_size(ptr) >= size, "block is smaller than requested");
+    }
+    FUZZ_CHECK(model, ptr != NULL, "allocation failed");
+    FuzzModel_check_block(model, ptr, size, alignment, SIZE_MAX);
+    FuzzModel_add(model, ptr, size);
+}
+
+/**
+ * Free one of the live blocks of the pool or slab, it may be handed out again.
+ */
+static void Fuzz_free_object(FuzzModel *model, FuzzTarget *target, FuzzInput *input) {
+    const uint8_t choice = FuzzInput_byte(input);
+    if (model->count == 0) return;
+    FuzzAllocation *allocation = &model->live[choice % model->count];
+    FUZZ_CHECK(model, Fuzz_intact(allocation, allocation->size), "live allocation was overwritten");
+    if (target->kind == FUZZ_POOL) Pool_free(&target->pool, allocation->ptr);
+    else Slab_free(allocation->ptr);
+    *allocation = model->live[--model->count];
+}
+
+static void Fuzz_mark(FuzzModel *model, FuzzTarget *target) {
+    if (model->marks_count == FUZZ_MAX_MARKS) return;
+    model->marks[model->marks_count++] = (FuzzMarkEntry){
+        .mark = FuzzTarget_mark(target),
+        .live = model->count,
+        .remaining = FuzzTarget_remaining(target),
+    };
+}
+
+/**
+ * Rewind to one of the marks, it stays valid while the ones after it are dropped.
+ */
+static void Fuzz_rewind(FuzzModel *model, FuzzTarget *target, FuzzInput *input) {
+    const uint8_t choice = FuzzInput_byte(input);
+    if (model->marks_count == 0) return;
+    const size_t depth = choice % model->marks_count;
+    const FuzzMarkEntry *entry = &model->marks[depth];
+    FuzzTarget_rewind(target, entry->mark);
+    model->count = entry->live;
+    model->marks_count = depth + 1;
+
+    // Pages a growable arena added after the mark stay and count as room
+    const size_t remaining = FuzzTarget_remaining(target);
+    if (Fuzz_is_bounded(target->kind)) FUZZ_CHECK(model, remaining == entry->remaining, "rewind lost room");
+    else FUZZ_CHECK(model, remaining >= entry->remaining, "rewind lost room");
+    FuzzModel_verify(model, false);
+}
+
+static void Fuzz_reset(FuzzModel *model, FuzzTarget *target) {
+    FuzzModel_verify(model, true);
+    FuzzTarget_reset(target);
+    model->count = 0;
+    model->marks_count = 0;
+
+    const size_t remaining = FuzzTarget_remaining(target);
+    if (Fuzz_is_bounded(target->kind)) FUZZ_CHECK(model, remaining == target->initial_remaining, "reset lost room");
+    else FUZZ_CHECK(model, remaining >= target->initial_remaining, "reset lost room");
+}
+
+static void Fuzz_reinit(FuzzModel *model, FuzzTarget *target) {
+    FuzzModel_verify(model, true);
+    FUZZ_CHECK(model, FuzzTarget_free(target), "child arena did not hand its block back");
+    FUZZ_CHECK(model, FuzzTarget_init(target, target->kind, model->op), "init failed");
+    target->initial_remaining = FuzzTarget_remaining(target);
+    model->count = 0;
+    model->marks_count = 0;
+}
+
+/**
+ * Run an input against one arena variant or allocator.
+ * @param kind The arena variant or allocator
+ * @param data The input
+ * @param size No. of bytes of the input
+ */
+static void Fuzz_run(const FuzzKind kind, const uint8_t *data, const size_t size) {
+    pthread_once(&Fuzz_pattern_once, Fuzz_pattern_init);
+    FuzzModel *model = malloc(sizeof(FuzzModel));
+    if (model == NULL) abort();
+    model->name = Fuzz_kind_names[kind];
+    model->op = 0;
+    model->seed = size > 0 ? data[0] : 0;
+    model->count = 0;
+    model->marks_count = 0;
+
+    FuzzTarget target;
+    FUZZ_CHECK(model, FuzzTarget_init(&target, kind, 0), "init failed");
+    target.initial_remaining = FuzzTarget_remaining(&target);
+
+    FuzzInput input = { .data = data, .size = size, .pos = 0 };
+    while (input.pos < input.size) {
+        model->op++;
+        const uint8_t op = FuzzInput_byte(&input);
+        if (Fuzz_is_free_list(kind)) {
+            if (op < 128) Fuzz_alloc_object(model, &target, &input);
+            else if (op < 240) Fuzz_free_object(model, &target, &input);
+            else if (op < 252) Fuzz_reset(model, &target);
+            else Fuzz_reinit(model, &target);
+        } else if (op < 80) {
+            Fuzz_alloc(model, &target, FuzzInput_size(&input), 0);
+        } else if (op < 128) {
+            const size_t alloc_size = FuzzInput_size(&input);
+            Fuzz_alloc(model, &target, alloc_size, FuzzInput_alignment(&input));
+        } else if (op < 144) {
+            if (Fuzz_is_growable(kind)) Fuzz_alloc_batch(model, &target, &input);
+            else Fuzz_alloc(model, &target, FuzzInput_size(&input), ARENA_DEFAULT_ALIGNMENT);
+        } else if (op < 192) {
+            Fuzz_realloc(model, &target, &input);
+        } else if (op < 216) {
+            Fuzz_mark(model, &target);
+        } else if (op < 240) {
+            Fuzz_rewind(model, &target, &input);
+        } else if (op < 252) {
+            Fuzz_reset(model, &target);
+        } else {
+            Fuzz_reinit(model, &target);
+        }
+        if (model->op % FUZZ_VERIFY_INTERVAL == 0) FuzzModel_verify(model, false);
+    }
+
+    FuzzModel_verify(model, true);
+    FUZZ_CHECK(model, FuzzTarget_free(&target), "child arena did not hand its block back");
+    free(model);
+}
+
+/**
+ * libFuzzer entry point, runs the input against every arena variant and allocator.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    for (int kind = 0; kind < FUZZ_KINDS; ++kind) Fuzz_run((FuzzKind)kind, data, size);
+    return 0;
+}
+
+#ifndef ARENA_LIBFUZZER
+static uint64_t Fuzz_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15u);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Fill a buffer with a random input of random length.
+ * @return No. of bytes of the input
+ */
+static size_t Fuzz_random_input(uint64_t *state, uint8_t *data) {
+    const size_t size = 1 + Fuzz_random(state) % FUZZ_INPUT_SIZE;
+    for (size_t i = 0; i < size; i += 8) {
+        const uint64_t bits = Fuzz_random(state);
+        memcpy(data + i, &bits, size - i < 8 ? size - i : 8);
+    }
+    return size;
+}
+
+/**
+ * A thread of the atomic arena stress, allocates and fills blocks concurrently with the others.
+ */
+typedef struct fuzz_thread_t {
+    pthread_t thread;
+    uint64_t state;
+    AtomicArena *arena;             // One of arena and growable is set
+    AtomicGrowableArena *growable;
+    FuzzAllocation allocations[FUZZ_THREAD_ALLOCS];
+    size_t count;
+    size_t failures;                // Failed allocations of the growable arena
+} FuzzThread;
+
+static void *Fuzz_atomic_thread(void *context) {
+    FuzzThread *thread = context;
+    pthread_once(&Fuzz_pattern_once, Fuzz_pattern_init);
+    uint8_t bytes[FUZZ_THREAD_ALLOCS * 4];
+    for (size_t i = 0; i < sizeof(bytes); ++i) bytes[i] = (uint8_t)Fuzz_random(&thread->state);
+    FuzzInput input = { .data = bytes, .size = sizeof(bytes), .pos = 0 };
+
+    thread->count = 0;
+    thread->failures = 0;
+    for (size_t i = 0; i < FUZZ_THREAD_ALLOCS; ++i) {
+        const size_t size = FuzzInput_size(&input);
+        const size_t alignment = FuzzInput_alignment(&input);
+        unsigned char *ptr = thread->arena != NULL ? AtomicArena_alloc_aligned(thread->arena, size, alignment)
+                                                   : AtomicGrowableArena_alloc_aligned(thread->growable, size, alignment);
+        if (ptr == NULL) {
+            thread->failures++;
+            continue;
+        }
+        FuzzAllocation *allocation = &thread->allocations[thread->count++];
+        *allocation = (FuzzAllocation){ .ptr = ptr, .size = size, .seed = (uint8_t)Fuzz_random(&thread->state) };
+        Fuzz_fill(allocation);
+    }
+    return NULL;
+}
+
+static int Fuzz_compare_allocations(const void *a, const void *b) {
+    const uintptr_t ptr_a = (uintptr_t)((const FuzzAllocation *)a)->ptr;
+    const uintptr_t ptr_b = (uintptr_t)((const FuzzAllocation *)b)->ptr;
+    return ptr_a < ptr_b ? -1 : ptr_a > ptr_b;
+}
+
+/**
+ * Allocate from an atomic arena on several threads at once, then check alignment, contents and
+ * that no two blocks overlap.
+ */
+static void Fuzz_stress_atomic(const char *name, AtomicArena *arena, AtomicGrowableArena *growable,
+                               const size_t rounds, uint64_t *state) {
+    static FuzzThread threads[FUZZ_THREADS];
+    static FuzzAllocation all[FUZZ_THREADS * FUZZ_THREAD_ALLOCS];
+    FuzzModel model = { .name = name };
+
+    for (size_t round = 0; round < rounds; ++round) {
+        model.op = round;
+        for (size_t t = 0; t < FUZZ_THREADS; ++t) {
+            threads[t].state = Fuzz_random(state);
+            threads[t].arena = arena;
+            threads[t].growable = growable;
+            FUZZ_CHECK(&model, pthread_create(&threads[t].thread, NULL, Fuzz_atomic_thread, &threads[t]) == 0,
+                       "could not start a thread");
+        }
+        size_t count = 0;
+        for (size_t t = 0; t < FUZZ_THREADS; ++t) {
+            pthread_join(threads[t].thread, NULL);
+            FUZZ_CHECK(&model, growable == NULL || threads[t].failures == 0, "allocation failed");
+            memcpy(all + count, threads[t].allocations, threads[t].count * sizeof(FuzzAllocation));
+            count += threads[t].count;
+        }
+
+        // Empty blocks may share the address of a neighbour, leave them out of the overlap check
+        size_t nonempty = 0;
+        for (size_t i = 0; i < count; ++i)
+            if (all[i].size > 0) all[nonempty++] = all[i];
+        qsort(all, nonempty, sizeof(FuzzAllocation), Fuzz_compare_allocations);
+        for (size_t i = 0; i < nonempty; ++i) {
+            FUZZ_CHECK(&model, Fuzz_intact(&all[i], all[i].size), "allocation was overwritten");
+            FUZZ_CHECK(&model, i + 1 == nonempty || all[i].ptr + all[i].size <= all[i + 1].ptr,
+                       "allocations of two threads overlap");
+        }
+
+        if (arena != NULL) AtomicArena_reset(arena);
+        else AtomicGrowableArena_reset(growable);
+    }
+}
+
+typedef struct fuzz_pool_thread_t {
+    pthread_t thread;
+    uint64_t state;
+    size_t inputs;
+} FuzzPoolThread;
+
+/**
+ * Run random inputs against per-thread arenas, all on the same PagePool.
+ */
+static void *Fuzz_pool_thread(void *context) {
+    FuzzPoolThread *thread = context;
+    uint8_t *data = malloc(FUZZ_INPUT_SIZE);
+    if (data == NULL) abort();
+    for (size_t i = 0; i < thread->inputs; ++i) {
+        const size_t size = Fuzz_random_input(&thread->state, data);
+        Fuzz_run(FUZZ_GROWABLE_POOL, data, size);
+    }
+    free(data);
+    return NULL;
+}
+
+static void Fuzz_stress_pool(const size_t inputs, uint64_t *state) {
+    FuzzPoolThread threads[FUZZ_THREADS];
+    for (size_t t = 0; t < FUZZ_THREADS; ++t) {
+        threads[t].state = Fuzz_random(state);
+        threads[t].inputs = inputs;
+        if (pthread_create(&threads[t].thread, NULL, Fuzz_pool_thread, &threads[t]) != 0) abort();
+    }
+    for (size_t t = 0; t < FUZZ_THREADS; ++t) pthread_join(threads[t].thread, NULL);
+}
+
+#ifdef ARENA_TRACE
+typedef struct fuzz_trace_thread_t {
+    pthread_t thread;
+    GrowableArena arena;
+    size_t tag;                     // Sizes of the thread are tag modulo FUZZ_THREADS
+    uint64_t state;
+} FuzzTraceThread;
+
+static void *Fuzz_trace_thread(void *context) {
+    FuzzTraceThread *thread = context;
+    for (size_t i = 0; i < 5 * FUZZ_THREAD_ALLOCS; ++i) {
+        const size_t size = thread->tag + FUZZ_THREADS * (Fuzz_random(&thread->state) % 64);
+        if (GrowableArena_alloc(&thread->arena, size) == NULL) abort();
+        if (i % 500 == 499) GrowableArena_reset(&thread->arena);
+    }
+    return NULL;
+}
+
+/**
+ * Allocate from per-thread arenas while reading the shared ring of recent events, a copied event
+ * must not mix the fields of two allocations.
+ */
+static void Fuzz_stress_trace(const size_t rounds, uint64_t *state) {
+    static FuzzTraceThread threads[FUZZ_THREADS];
+    static ArenaTraceEvent events[ARENA_TRACE_RING_SIZE];
+    FuzzModel model = { .name = "ArenaTrace" };
+    for (size_t t = 0; t < FUZZ_THREADS; ++t)
+        FUZZ_CHECK(&model, GrowableArena_init(&threads[t].arena, 4096), "init failed");
+
+    for (size_t round = 0; round < rounds; ++round) {
+        model.op = round;
+        for (size_t t = 0; t < FUZZ_THREADS; ++t) {
+            threads[t].tag = t;
+            threads[t].state = Fuzz_random(state);
+            FUZZ_CHECK(&model, pthread_create(&threads[t].thread, NULL, Fuzz_trace_thread, &threads[t]) == 0,
+                       "could not start a thread");
+        }
+        for (size_t reads = 0; reads < 20; ++reads) {
+            const size_t count = ArenaTrace_recent(events, ARENA_TRACE_RING_SIZE);
+            for (size_t i = 0; i < count; ++i) {
+                const FuzzTraceThread *owner = NULL;
+                for (size_t t = 0; t < FUZZ_THREADS; ++t)
+                    if (events[i].arena == &threads[t].arena) owner = &threads[t];
+                FUZZ_CHECK(&model, events[i].site != NULL, "event without a callsite");
+                FUZZ_CHECK(&model, owner == NULL || events[i].size % FUZZ_THREADS == owner->tag,
+                           "event mixes two allocations");
+            }
+        }
+        for (size_t t = 0; t < FUZZ_THREADS; ++t) pthread_join(threads[t].thread, NULL);
+    }
+    for (size_t t = 0; t < FUZZ_THREADS; ++t) GrowableArena_free(&threads[t].arena);
+}
+#endif
+
+/**
+ * Run a file as a single input.
+ */
+static bool Fuzz_replay(const char *path) {
+    size_t size = 0;
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    uint8_t *data = malloc(1024 * 1024);
+    if (data != NULL) size = fread(data, 1, 1024 * 1024, file);
+    fclose(file);
+    if (data == NULL) return false;
+    printf("Replaying %s, %zu bytes\n", path, size);
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && (argv[1][0] < '0' || argv[1][0] > '9')) {
+        for (int i = 1; i < argc; ++i) {
+            if (!Fuzz_replay(argv[i])) {
+                fprintf(stderr, "Cannot read %s\n", argv[i]);
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    const size_t iterations = argc > 1 ? strtoull(argv[1], NULL, 10) : 500;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : (uint64_t)time(NULL);
+    printf("Running %zu random inputs against %d arena variants and allocators, seed %llu\n", iterations,
+           FUZZ_KINDS, (unsigned long long)seed);
+
+    uint64_t state = seed;
+    uint8_t *data = malloc(FUZZ_INPUT_SIZE);
+    if (data == NULL) return 1;
+    for (size_t i = 0; i < iterations; ++i) {
+        const size_t size = Fuzz_random_input(&state, data);
+        LLVMFuzzerTestOneInput(data, size);
+    }
+    free(data);
+
+    const size_t rounds = iterations / 25 + 1;
+    printf("Allocating from an AtomicArena on %d threads, %zu rounds\n", FUZZ_THREADS, rounds);
+    AtomicArena arena = {0};
+    if (!AtomicArena_init(&arena, 4 * 1024 * 1024)) return 1;
+    Fuzz_stress_atomic("AtomicArena", &arena, NULL, rounds, &state);
+    AtomicArena_free(&arena);
+
+    printf("Allocating from an AtomicGrowableArena on %d threads, %zu rounds\n", FUZZ_THREADS, rounds);
+    AtomicGrowableArena growable = {0};
+    if (!AtomicGrowableArena_init(&growable, 4096)) return 1;
+    Fuzz_stress_atomic("AtomicGrowableArena", NULL, &growable, rounds, &state);
+    AtomicGrowableArena_free(&growable);
+
+    printf("Running %zu random inputs on each of %d threads sharing a PagePool\n", rounds, FUZZ_THREADS);
+    Fuzz_stress_pool(rounds, &state);
+    pthread_once(&Fuzz_pool_once, Fuzz_pool_init);
+    PagePool_free(&Fuzz_pool);
+
+#ifdef ARENA_TRACE
+    printf("Tracing allocations on %d threads while reading recent events, %zu rounds\n", FUZZ_THREADS, rounds);
+    Fuzz_stress_trace(rounds, &state);
+#endif
+
+    printf("No failures\n");
+    return 0;
+}
+#endif
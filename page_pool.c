@@ -0,0 +1,256 @@
+#ifndef PAGE_POOL_C
+#define PAGE_POOL_C
+
+#include <pthread.h>
+#include <stdalign.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "arena.c"
+
+/**
+ * Maximum number of NUMA nodes the pool keeps separate free lists for. Systems with more nodes
+ * share lists.
+ */
+#define PAGE_POOL_MAX_NODES 8
+
+/**
+ * Header in front of every pooled block, it remembers the node that first touched the block.
+ */
+typedef struct page_pool_block_t {
+    struct page_pool_block_t *next;
+    unsigned node;
+} PagePoolBlock;
+
+/**
+ * Size of the block header, rounded up so the pages keep the alignment of malloc.
+ */
+#define PAGE_POOL_BLOCK_HEADER_SIZE \
+    ((sizeof(PagePoolBlock) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+
+/**
+ * Free list of a NUMA node. Each node sits on its own cache line.
+ */
+typedef struct page_pool_node_t {
+    alignas(64) pthread_mutex_t lock;
+    PagePoolBlock *free;
+    size_t free_pages;
+} PagePoolNode;
+
+/**
+ * Shared pool of GrowableArena pages for per-thread arenas.
+ *
+ * Every thread gets its own GrowableArena (PagePool_thread_arena), so allocation never touches a
+ * shared cache line. New pages are taken from the pool and pages released by a reset or by thread
+ * exit are returned to it. Pages are kept on the free list of the NUMA node of the thread that first
+ * touched them and are only reused by threads running on that node.
+ *
+ * max_free_pages limits the free pages per node, pages beyond it are released to malloc. All thread
+ * arenas must be released before PagePool_free.
+ */
+typedef struct page_pool_t {
+    size_t page_size;
+    size_t block_size;
+    size_t retain_pages;
+    size_t max_free_pages;
+    ArenaAllocator allocator;
+    pthread_key_t thread_arena;
+    PagePoolNode nodes[PAGE_POOL_MAX_NODES];
+} PagePool;
+
+/**
+ * Returns the NUMA node the calling thread runs on.
+ * @return Index into the node free lists
+ */
+static unsigned PagePool_current_node(void) {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) return node % PAGE_POOL_MAX_NODES;
+#endif
+    return 0;
+}
+
+/**
+ * ArenaAllocator callback, takes a page from the free list of the current node.
+ */
+static void *PagePool_alloc_block(void *context, size_t size) {
+    PagePool *pool = context;
+    if (size != pool->block_size) return malloc(size);
+
+    const unsigned node = PagePool_current_node();
+    PagePoolNode *free_list = &pool->nodes[node];
+    pthread_mutex_lock(&free_list->lock);
+    PagePoolBlock *block = free_list->free;
+    if (block != NULL) {
+        free_list->free = block->next;
+        free_list->free_pages--;
+    }
+    pthread_mutex_unlock(&free_list->lock);
+
+    if (block == NULL) {
+        // Writing the header is the first touch, which places the block on the current node
+        block = malloc(PAGE_POOL_BLOCK_HEADER_SIZE + size);
+        if (block == NULL) return NULL;
+        block->node = node;
+    }
+    block->next = NULL;
+    return (char *)block + PAGE_POOL_BLOCK_HEADER_SIZE;
+}
+
+/**
+ * ArenaAllocator callback, returns a page to the free list of the node that first touched it.
+ */
+static void PagePool_free_block(void *context, void *ptr, size_t size) {
+    PagePool *pool = context;
+    if (size != pool->block_size) {
+        free(ptr);
+        return;
+    }
+
+    PagePoolBlock *block = (PagePoolBlock *)((char *)ptr - PAGE_POOL_BLOCK_HEADER_SIZE);
+    PagePoolNode *free_list = &pool->nodes[block->node];
+    pthread_mutex_lock(&free_list->lock);
+    const bool keep = pool->max_free_pages == 0 || free_list->free_pages < pool->max_free_pages;
+    if (keep) {
+        block->next = free_list->free;
+        free_list->free = block;
+        free_list->free_pages++;
+    }
+    pthread_mutex_unlock(&free_list->lock);
+
+    if (!keep) free(block);
+}
+
+/**
+ * Destructor of the thread arena key, returns the pages of an exiting thread to the pool.
+ */
+static void PagePool_thread_arena_destructor(void *arena) {
+    GrowableArena_free(arena);
+    free(arena);
+}
+
+/**
+ * Initialize a page pool.
+ * @param pool An empty PagePool struct
+ * @param page_size The size of a single page in bytes
+ * @param retain_pages No. of pages a thread arena keeps on reset, 0 for no limit
+ * @return true for success, false if initialization failed
+ */
+bool PagePool_init(PagePool *pool, const size_t page_size, const size_t retain_pages) {
+    if (pool == NULL || page_size > SIZE_MAX - ARENA_PAGE_HEADER_SIZE - PAGE_POOL_BLOCK_HEADER_SIZE)
+        return false;
+    if (pthread_key_create(&pool->thread_arena, PagePool_thread_arena_destructor) != 0) return false;
+
+    pool->page_size = page_size;
+    pool->block_size = ARENA_PAGE_HEADER_SIZE + page_size;
+    pool->retain_pages = retain_pages;
+    pool->max_free_pages = 0;
+    pool->allocator.alloc = PagePool_alloc_block;
+    pool->allocator.free = PagePool_free_block;
+    pool->allocator.context = pool;
+    pool->allocator.realloc = NULL;
+    for (size_t i = 0; i < PAGE_POOL_MAX_NODES; ++i) {
+        pthread_mutex_init(&pool->nodes[i].lock, NULL);
+        pool->nodes[i].free = NULL;
+        pool->nodes[i].free_pages = 0;
+    }
+    return true;
+}
+
+/**
+ * Initialize a growable arena that takes its pages from the pool. Free the arena with
+ * GrowableArena_free to return its pages.
+ * @param pool The page pool
+ * @param arena An empty GrowableArena struct
+ * @return true for success, false if allocation failed
+ */
+bool PagePool_init_arena(PagePool *pool, GrowableArena *arena) {
+    if (pool == NULL) return false;
+    const GrowableArenaOptions options = {
+        .page_size = pool->page_size,
+        .growth = ARENA_GROWTH_FIXED,
+        .retain_pages = pool->retain_pages,
+        .allocator = &pool->allocator,
+    };
+    return GrowableArena_init_with_options(arena, &options);
+}
+
+/**
+ * Returns the growable arena of the calling thread, it is created on first use. The arena is freed
+ * when the thread exits or by PagePool_release_thread_arena.
+ * @param pool The page pool
+ * @return The arena of the calling thread or NULL if allocation failed
+ */
+GrowableArena *PagePool_thread_arena(PagePool *pool) {
+    if (pool == NULL) return NULL;
+    GrowableArena *arena = pthread_getspecific(pool->thread_arena);
+    if (arena != NULL) return arena;
+
+    arena = malloc(sizeof(GrowableArena));
+    if (arena == NULL) return NULL;
+    if (!PagePool_init_arena(pool, arena)) {
+        free(arena);
+        return NULL;
+    }
+    if (pthread_setspecific(pool->thread_arena, arena) != 0) {
+        PagePool_thread_arena_destructor(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+/**
+ * Free the growable arena of the calling thread and return its pages to the pool.
+ * @param pool The page pool
+ */
+void PagePool_release_thread_arena(PagePool *pool) {
+    if (pool == NULL) return;
+    GrowableArena *arena = pthread_getspecific(pool->thread_arena);
+    if (arena == NULL) return;
+    pthread_setspecific(pool->thread_arena, NULL);
+    PagePool_thread_arena_destructor(arena);
+}
+
+/**
+ * Returns the number of free pages in the pool.
+ * @param pool The page pool
+ * @return No. of free pages over all nodes
+ */
+size_t PagePool_free_pages(PagePool *pool) {
+    if (pool == NULL) return 0;
+    size_t pages = 0;
+    for (size_t i = 0; i < PAGE_POOL_MAX_NODES; ++i) {
+        pthread_mutex_lock(&pool->nodes[i].lock);
+        pages += pool->nodes[i].free_pages;
+        pthread_mutex_unlock(&pool->nodes[i].lock);
+    }
+    return pages;
+}
+
+/**
+ * Release the free pages of the pool. All arenas using the pool must have been freed, the calling
+ * thread's arena is released here.
+ * @param pool The page pool to free
+ */
+void PagePool_free(PagePool *pool) {
+    if (pool == NULL) return;
+    PagePool_release_thread_arena(pool);
+    pthread_key_delete(pool->thread_arena);
+
+    for (size_t i = 0; i < PAGE_POOL_MAX_NODES; ++i) {
+        PagePoolBlock *block = pool->nodes[i].free;
+        while (block != NULL) {
+            PagePoolBlock *next = block->next;
+            free(block);
+            block = next;
+        }
+        pool->nodes[i].free = NULL;
+        pool->nodes[i].free_pages = 0;
+        pthread_mutex_destroy(&pool->nodes[i].lock);
+    }
+}
+
+#endif
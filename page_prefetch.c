@@ -0,0 +1,169 @@
+#ifndef PAGE_PREFETCH_C
+#define PAGE_PREFETCH_C
+
+#include <pthread.h>
+
+#include "arena.c"
+
+/**
+ * Background allocation of GrowableArena pages.
+ *
+ * A worker thread keeps one spare page allocated and faulted in. When a growable arena needs a
+ * new page it takes the spare, and the worker immediately prepares the next one while the arena
+ * fills the page it just got. Growth therefore costs a mutex instead of an allocation and page
+ * faults on the thread that allocates. Requests of any other size, such as large blocks, go to
+ * the backing allocator directly.
+ *
+ * Usage:
+ *
+ * 1. Create a PagePrefetcher struct
+ * 2. Initialize it with the page size and a backing allocator: PagePrefetcher_init
+ * 3. Create growable arenas with PagePrefetcher_init_arena
+ * 4. Free the arenas, then the prefetcher with PagePrefetcher_free
+ *
+ * Combine it with ArenaAllocator_prefault as backing allocator to have the spare pages locked.
+ */
+typedef struct page_prefetcher_t {
+    size_t page_size;
+    size_t block_size;
+    const ArenaAllocator *backing;      // Where the pages come from, NULL for malloc
+    ArenaAllocator allocator;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    void *spare;            // The prepared page or NULL
+    bool stop;
+    size_t hits;            // Pages served from the spare
+    size_t misses;          // Pages allocated on the thread of the arena
+    pthread_t thread;
+} PagePrefetcher;
+
+/**
+ * Write to every OS page of a block, so the page faults happen on the worker thread.
+ */
+static void PagePrefetcher_touch(void *block, const size_t size) {
+    const long os_page_size = sysconf(_SC_PAGESIZE);
+    const size_t page_size = os_page_size > 0 ? (size_t)os_page_size : 4096;
+    volatile char *bytes = block;
+    for (size_t i = 0; i < size; i += page_size) bytes[i] = 0;
+    if (size > 0) bytes[size - 1] = 0;
+}
+
+/**
+ * Worker thread, refills the spare whenever it has been taken.
+ */
+static void *PagePrefetcher_run(void *context) {
+    PagePrefetcher *prefetcher = context;
+    pthread_mutex_lock(&prefetcher->lock);
+    while (!prefetcher->stop) {
+        if (prefetcher->spare != NULL) {
+            pthread_cond_wait(&prefetcher->wake, &prefetcher->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&prefetcher->lock);
+        void *block = ArenaAllocator_alloc(prefetcher->backing, prefetcher->block_size);
+        if (block != NULL) PagePrefetcher_touch(block, prefetcher->block_size);
+        pthread_mutex_lock(&prefetcher->lock);
+        if (block != NULL) {
+            prefetcher->spare = block;
+        } else if (!prefetcher->stop) {
+            // Out of memory, retry when the next page is requested
+            pthread_cond_wait(&prefetcher->wake, &prefetcher->lock);
+        }
+    }
+    pthread_mutex_unlock(&prefetcher->lock);
+    return NULL;
+}
+
+/**
+ * ArenaAllocator callback, hands out the spare page and wakes the worker to prepare the next one.
+ */
+static void *PagePrefetcher_alloc_block(void *context, size_t size) {
+    PagePrefetcher *prefetcher = context;
+    if (size == prefetcher->block_size) {
+        pthread_mutex_lock(&prefetcher->lock);
+        void *block = prefetcher->spare;
+        prefetcher->spare = NULL;
+        if (block != NULL) prefetcher->hits++;
+        else prefetcher->misses++;
+        pthread_cond_signal(&prefetcher->wake);
+        pthread_mutex_unlock(&prefetcher->lock);
+        if (block != NULL) return block;
+    }
+    return ArenaAllocator_alloc(prefetcher->backing, size);
+}
+
+/**
+ * ArenaAllocator callback, releases memory to the backing allocator.
+ */
+static void PagePrefetcher_free_block(void *context, void *ptr, size_t size) {
+    PagePrefetcher *prefetcher = context;
+    ArenaAllocator_free(prefetcher->backing, ptr, size);
+}
+
+/**
+ * Initialize a page prefetcher and start its worker thread.
+ * @param prefetcher An empty PagePrefetcher struct
+ * @param page_size The size of a single page in bytes
+ * @param backing The allocator the pages come from or NULL for malloc, must outlive the prefetcher
+ * @return true for success, false if the thread could not be started
+ */
+bool PagePrefetcher_init(PagePrefetcher *prefetcher, const size_t page_size, const ArenaAllocator *backing) {
+    if (prefetcher == NULL || page_size > SIZE_MAX - ARENA_PAGE_HEADER_SIZE) return false;
+    prefetcher->page_size = page_size;
+    prefetcher->block_size = ARENA_PAGE_HEADER_SIZE + page_size;
+    prefetcher->backing = backing;
+    prefetcher->allocator.alloc = PagePrefetcher_alloc_block;
+    prefetcher->allocator.free = PagePrefetcher_free_block;
+    prefetcher->allocator.context = prefetcher;
+    prefetcher->allocator.realloc = NULL;
+    prefetcher->spare = NULL;
+    prefetcher->stop = false;
+    prefetcher->hits = 0;
+    prefetcher->misses = 0;
+    pthread_mutex_init(&prefetcher->lock, NULL);
+    pthread_cond_init(&prefetcher->wake, NULL);
+    if (pthread_create(&prefetcher->thread, NULL, PagePrefetcher_run, prefetcher) != 0) {
+        pthread_cond_destroy(&prefetcher->wake);
+        pthread_mutex_destroy(&prefetcher->lock);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Initialize a growable arena that takes its pages from the prefetcher. Free the arena before the
+ * prefetcher.
+ * @param prefetcher The page prefetcher
+ * @param arena An empty GrowableArena struct
+ * @return true for success, false if allocation failed
+ */
+bool PagePrefetcher_init_arena(PagePrefetcher *prefetcher, GrowableArena *arena) {
+    if (prefetcher == NULL) return false;
+    const GrowableArenaOptions options = {
+        .page_size = prefetcher->page_size,
+        .growth = ARENA_GROWTH_FIXED,
+        .allocator = &prefetcher->allocator,
+    };
+    return GrowableArena_init_with_options(arena, &options);
+}
+
+/**
+ * Stop the worker thread and release the spare page. All arenas using the prefetcher must be
+ * freed before.
+ * @param prefetcher The page prefetcher
+ */
+void PagePrefetcher_free(PagePrefetcher *prefetcher) {
+    if (prefetcher == NULL) return;
+    pthread_mutex_lock(&prefetcher->lock);
+    prefetcher->stop = true;
+    pthread_cond_signal(&prefetcher->wake);
+    pthread_mutex_unlock(&prefetcher->lock);
+    pthread_join(prefetcher->thread, NULL);
+
+    if (prefetcher->spare != NULL) ArenaAllocator_free(prefetcher->backing, prefetcher->spare, prefetcher->block_size);
+    prefetcher->spare = NULL;
+    pthread_cond_destroy(&prefetcher->wake);
+    pthread_mutex_destroy(&prefetcher->lock);
+}
+
+#endif
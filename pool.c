@@ -0,0 +1,125 @@
+#ifndef POOL_C
+#define POOL_C
+
+#include "arena.c"
+
+/**
+ * Size of a cache line, used for POOL_CACHE_ALIGNED.
+ */
+#define POOL_CACHE_LINE_SIZE 64
+
+/**
+ * Flags for Pool_init.
+ */
+enum {
+    POOL_CACHE_ALIGNED = 1 << 0,    // Align slots to cache lines, so objects never share a line
+};
+
+/**
+ * A free slot, the free list link lives inside the slot itself.
+ */
+typedef struct pool_slot_t {
+    struct pool_slot_t *next;
+} PoolSlot;
+
+/**
+ * Fixed-size object pool allocator.
+ *
+ * Carves slots of a single size out of GrowableArena pages. Freed slots go onto an intrusive free
+ * list and are handed out again first, so allocation and free are O(1) without per-object headers.
+ * Pool_reset releases all objects at once by resetting the arena.
+ *
+ * Usage:
+ *
+ * 1. Create a Pool struct
+ * 2. Initialize the pool with the object size: Pool_init
+ * 3. Allocate objects with Pool_alloc and release them with Pool_free
+ * 4. If desired, release all objects with Pool_reset
+ * 5. Finally, release the pool memory with Pool_destroy
+ */
+typedef struct pool_t {
+    GrowableArena arena;
+    size_t slot_size;
+    size_t alignment;
+    PoolSlot *free_list;
+} Pool;
+
+/**
+ * Initialize a pool.
+ * @param pool An empty Pool struct
+ * @param object_size Size of a single object in bytes
+ * @param objects_per_page No. of objects in a single arena page
+ * @param flags POOL_* flags or 0
+ * @return true for success, false if allocation failed
+ */
+bool Pool_init(Pool *pool, const size_t object_size, const size_t objects_per_page, const unsigned flags) {
+    if (pool == NULL || objects_per_page == 0) return false;
+
+    const size_t alignment = (flags & POOL_CACHE_ALIGNED) ? POOL_CACHE_LINE_SIZE : ARENA_DEFAULT_ALIGNMENT;
+    const size_t size = object_size < sizeof(PoolSlot) ? sizeof(PoolSlot) : object_size;
+    if (size > SIZE_MAX - alignment) return false;
+    const size_t slot_size = (size + alignment - 1) & ~(alignment - 1);
+    if (slot_size > (SIZE_MAX - ARENA_ALLOC_OVERHEAD - 2 * alignment) / objects_per_page) return false;
+
+    // Every slot carries the allocation overhead of debug builds, rounded up to keep slots aligned
+    const size_t stride = slot_size + ((ARENA_ALLOC_OVERHEAD + alignment - 1) & ~(alignment - 1));
+
+    // Room for the padding that aligns the first slot of a page
+    if (!GrowableArena_init(&pool->arena, stride * objects_per_page + ArenaPage_padding(alignment)))
+        return false;
+    pool->slot_size = slot_size;
+    pool->alignment = alignment;
+    pool->free_list = NULL;
+    return true;
+}
+
+/**
+ * Allocate an object from the pool.
+ * @param pool The pool
+ * @return Pointer to the object or NULL if allocation failed
+ */
+void *Pool_alloc(Pool *pool) {
+    if (pool == NULL) return NULL;
+
+    PoolSlot *slot = pool->free_list;
+    if (slot != NULL) {
+        pool->free_list = slot->next;
+        return slot;
+    }
+    return GrowableArena_alloc_aligned(&pool->arena, pool->slot_size, pool->alignment);
+}
+
+/**
+ * Return an object to the pool.
+ * @param pool The pool the object was allocated from
+ * @param ptr The object or NULL
+ */
+void Pool_free(Pool *pool, void *ptr) {
+    if (pool == NULL || ptr == NULL) return;
+
+    PoolSlot *slot = ptr;
+    slot->next = pool->free_list;
+    pool->free_list = slot;
+}
+
+/**
+ * Release all objects of the pool at once, the pages are kept for reuse.
+ * @param pool The pool to reset
+ */
+void Pool_reset(Pool *pool) {
+    if (pool == NULL) return;
+    pool->free_list = NULL;
+    GrowableArena_reset(&pool->arena);
+}
+
+/**
+ * Release the memory of the pool. After this call, the pool cannot be used anymore.
+ * @param pool The pool to destroy
+ */
+void Pool_destroy(Pool *pool) {
+    if (pool == NULL) return;
+    pool->free_list = NULL;
+    GrowableArena_free(&pool->arena);
+}
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef SLAB_C
+#define SLAB_C
+
+#include "arena.c"
+
+/**
+ * Size and alignment of a slab. Every slab is a single GrowableArena page.
+ */
+#define SLAB_SPAN (64 * 1024)
+
+/**
+ * Smallest and largest size class, classes are the powers of two in between. Classes go up to
+ * 16 KiB rather than 4 KiB: a block of 4 to 16 KiB would otherwise take a 64 KiB span of its own
+ * and waste most of it, while a 16 KiB slab only loses one of its four objects to the header.
+ */
+#define SLAB_MIN_SIZE 16
+#define SLAB_MAX_SIZE 16384
+#define SLAB_CLASSES 11
+
+/**
+ * Size class of blocks bigger than SLAB_MAX_SIZE, which get a span of their own.
+ */
+#define SLAB_LARGE SLAB_CLASSES
+
+/**
+ * Freed large spans of up to this many SLAB_SPANs (1 MiB) are kept for reuse, one free list per
+ * length. Longer spans go back to the system allocator on free.
+ */
+#define SLAB_CACHED_SPANS 16
+
+/**
+ * Metadata at the start of every slab. Slab_free finds it by rounding the object address down to
+ * SLAB_SPAN.
+ */
+typedef struct slab_header_t {
+    struct slab_t *slab;
+    struct slab_header_t *prev;     // Neighbours in the list of large spans
+    struct slab_header_t *next;
+    size_t size_class;
+    size_t size;                    // Object size, or the bytes used of a large span
+} SlabHeader;
+
+/**
+ * Offset of the slab header within a span, after the arena page header and the allocation header
+ * of debug builds.
+ */
+#define SLAB_HEADER_OFFSET (ARENA_PAGE_HEADER_SIZE + ARENA_ALLOC_HEADER_SIZE)
+
+/**
+ * Offset of the objects within a slab, after the slab header, rounded up to a cache line.
+ */
+#define SLAB_OBJECTS_OFFSET ((SLAB_HEADER_OFFSET + sizeof(SlabHeader) + 63) & ~(size_t)63)
+
+/**
+ * A free object, the free list link lives inside the object itself.
+ */
+typedef struct slab_object_t {
+    struct slab_object_t *next;
+} SlabObject;
+
+/**
+ * State of a size class: the free list and the unused tail of the newest slab.
+ */
+typedef struct slab_class_t {
+    SlabObject *free;
+    char *next;
+    char *end;
+} SlabClass;
+
+/**
+ * Size-class slab allocator.
+ *
+ * Serves blocks of SLAB_MIN_SIZE to SLAB_MAX_SIZE bytes from power-of-two size classes. Each slab is
+ * a SLAB_SPAN aligned GrowableArena page holding objects of a single class, every class has its own
+ * free list. Slab_free only needs the pointer: the slab header is found by rounding it down to
+ * SLAB_SPAN. Bigger blocks get a dedicated span of whole SLAB_SPANs. Freed spans of up to
+ * SLAB_CACHED_SPANS are kept on a free list per length, so repeated large requests do not go to
+ * the system allocator. Blocks over 1 MiB are the exception: their spans are taken from and
+ * released to aligned_alloc on every call. They do not use the large blocks of the GrowableArena,
+ * which are only released on reset, so a freed block of many MiB would stay allocated until then.
+ * Slab_reset and Slab_destroy release all blocks at once like an arena.
+ *
+ * Usage:
+ *
+ * 1. Create a Slab struct
+ * 2. Initialize the allocator: Slab_init
+ * 3. Allocate blocks with Slab_alloc and release them with Slab_free
+ * 4. If desired, release all blocks with Slab_reset
+ * 5. Finally, release the memory with Slab_destroy
+ */
+typedef struct slab_t {
+    GrowableArena arena;
+    SlabClass classes[SLAB_CLASSES];
+    SlabHeader *large;                          // Large spans in use
+    SlabHeader *spans[SLAB_CACHED_SPANS];       // Free large spans, by no. of SLAB_SPANs - 1
+} Slab;
+
+/**
+ * ArenaAllocator callbacks handing out SLAB_SPAN aligned pages.
+ */
+static void *Slab_alloc_span(void *context, size_t size) {
+    (void)context;
+    return aligned_alloc(SLAB_SPAN, (size + SLAB_SPAN - 1) & ~(size_t)(SLAB_SPAN - 1));
+}
+
+static void Slab_free_span(void *context, void *ptr, size_t size) {
+    (void)context;
+    (void)size;
+    free(ptr);
+}
+
+static const ArenaAllocator Slab_span_allocator = {
+    .alloc = Slab_alloc_span,
+    .free = Slab_free_span,
+    .context = NULL,
+};
+
+/**
+ * Returns the header of the slab a block belongs to.
+ * @param ptr A block returned by Slab_alloc
+ * @return The slab header
+ */
+static inline SlabHeader *Slab_header(const void *ptr) {
+    const uintptr_t span = (uintptr_t)ptr & ~(uintptr_t)(SLAB_SPAN - 1);
+    return (SlabHeader *)(span + SLAB_HEADER_OFFSET);
+}
+
+/**
+ * Initialize a slab allocator. No slab is allocated until the first request of a size class.
+ * @param slab An empty Slab struct
+ * @return true for success, false if allocation failed
+ */
+bool Slab_init(Slab *slab) {
+    if (slab == NULL) return false;
+    const GrowableArenaOptions options = {
+        .page_size = SLAB_SPAN - ARENA_PAGE_HEADER_SIZE,
+        .growth = ARENA_GROWTH_FIXED,
+        .allocator = &Slab_span_allocator,
+    };
+    if (!GrowableArena_init_with_options(&slab->arena, &options)) return false;
+    for (size_t i = 0; i < SLAB_CLASSES; ++i)
+        slab->classes[i] = (SlabClass){0};
+    slab->large = NULL;
+    for (size_t i = 0; i < SLAB_CACHED_SPANS; ++i)
+        slab->spans[i] = NULL;
+    return true;
+}
+
+/**
+ * Returns the size class of a request.
+ * @param size No. of bytes, at most SLAB_MAX_SIZE
+ * @return Index of the size class
+ */
+static inline size_t Slab_size_class(const size_t size) {
+    size_t size_class = 0;
+    while (((size_t)SLAB_MIN_SIZE << size_class) < size) size_class++;
+    return size_class;
+}
+
+/**
+ * Returns the no. of SLAB_SPANs of a large span.
+ * @param used Bytes used of the span, including the headers
+ */
+static inline size_t Slab_span_count(const size_t used) {
+    return (used + SLAB_SPAN - 1) / SLAB_SPAN;
+}
+
+/**
+ * Keep a large span that is not used anymore for reuse, or release it if it is too long.
+ */
+static void Slab_release_span(Slab *slab, SlabHeader *header) {
+    const size_t count = Slab_span_count(header->size);
+    if (count > SLAB_CACHED_SPANS) {
+        Slab_free_span(NULL, (char *)header - SLAB_HEADER_OFFSET, count * SLAB_SPAN);
+        return;
+    }
+    header->next = slab->spans[count - 1];
+    slab->spans[count - 1] = header;
+}
+
+/**
+ * Allocate a dedicated span for a block bigger than SLAB_MAX_SIZE, a freed span of the same length
+ * if there is one.
+ */
+static void *Slab_alloc_large(Slab *slab, const size_t size) {
+    if (size > SIZE_MAX - SLAB_OBJECTS_OFFSET - SLAB_SPAN) return NULL;
+    const size_t used = SLAB_OBJECTS_OFFSET + size;
+    const size_t count = Slab_span_count(used);
+
+    SlabHeader *header;
+    if (count <= SLAB_CACHED_SPANS && slab->spans[count - 1] != NULL) {
+        header = slab->spans[count - 1];
+        slab->spans[count - 1] = header->next;
+    } else {
+        char *span = Slab_alloc_span(NULL, count * SLAB_SPAN);
+        if (span == NULL) return NULL;
+        header = (SlabHeader *)(span + SLAB_HEADER_OFFSET);
+    }
+    header->slab = slab;
+    header->size_class = SLAB_LARGE;
+    header->size = used;
+    header->prev = NULL;
+    header->next = slab->large;
+    if (slab->large != NULL) slab->large->prev = header;
+    slab->large = header;
+    return (char *)header - SLAB_HEADER_OFFSET + SLAB_OBJECTS_OFFSET;
+}
+
+/**
+ * Allocate a block from the slab allocator. Blocks are aligned to ARENA_DEFAULT_ALIGNMENT.
+ * @param slab The slab allocator
+ * @param size No. of bytes to allocate
+ * @return Pointer to the block or NULL if allocation failed
+ */
+void *Slab_alloc(Slab *slab, const size_t size) {
+    if (slab == NULL) return NULL;
+    if (size > SLAB_MAX_SIZE) return Slab_alloc_large(slab, size);
+
+    const size_t size_class = Slab_size_class(size);
+    SlabClass *state = &slab->classes[size_class];
+    SlabObject *object = state->free;
+    if (object != NULL) {
+        state->free = object->next;
+        return object;
+    }
+
+    const size_t object_size = (size_t)SLAB_MIN_SIZE << size_class;
+    if (state->next == NULL || object_size > (size_t)(state->end - state->next)) {
+        // Start a new slab, it takes a whole arena page
+        const size_t slab_size = slab->arena.options.page_size - ARENA_ALLOC_OVERHEAD;
+        char *data = GrowableArena_alloc(&slab->arena, slab_size);
+        if (data == NULL) return NULL;
+        SlabHeader *header = (SlabHeader *)data;
+        header->slab = slab;
+        header->prev = NULL;
+        header->next = NULL;
+        header->size_class = size_class;
+        header->size = object_size;
+        state->next = data - SLAB_HEADER_OFFSET + SLAB_OBJECTS_OFFSET;
+        state->end = data + slab_size;
+    }
+
+    void *mem = state->next;
+    state->next += object_size;
+    return mem;
+}
+
+/**
+ * Release a block to the allocator it came from.
+ * @param ptr A block returned by Slab_alloc or NULL
+ */
+void Slab_free(void *ptr) {
+    if (ptr == NULL) return;
+    SlabHeader *header = Slab_header(ptr);
+    Slab *slab = header->slab;
+
+    if (header->size_class == SLAB_LARGE) {
+        if (header->prev != NULL) header->prev->next = header->next;
+        else slab->large = header->next;
+        if (header->next != NULL) header->next->prev = header->prev;
+        Slab_release_span(slab, header);
+        return;
+    }
+
+    SlabObject *object = ptr;
+    object->next = slab->classes[header->size_class].free;
+    slab->classes[header->size_class].free = object;
+}
+
+/**
+ * Returns the usable size of a block.
+ * @param ptr A block returned by Slab_alloc
+ * @return No. of bytes usable in the block
+ */
+size_t Slab_size(const void *ptr) {
+    if (ptr == NULL) return 0;
+    const SlabHeader *header = Slab_header(ptr);
+    if (header->size_class == SLAB_LARGE) return header->size - SLAB_OBJECTS_OFFSET;
+    return header->size;
+}
+
+/**
+ * Release a list of large spans to the system allocator.
+ */
+static void Slab_free_spans(SlabHeader *header) {
+    while (header != NULL) {
+        SlabHeader *next = header->next;
+        Slab_free_span(NULL, (char *)header - SLAB_HEADER_OFFSET, Slab_span_count(header->size) * SLAB_SPAN);
+        header = next;
+    }
+}
+
+/**
+ * Release all blocks at once, the slabs and the large spans are kept for reuse.
+ * @param slab The slab allocator to reset
+ */
+void Slab_reset(Slab *slab) {
+    if (slab == NULL) return;
+    for (size_t i = 0; i < SLAB_CLASSES; ++i)
+        slab->classes[i] = (SlabClass){0};
+    SlabHeader *header = slab->large;
+    while (header != NULL) {
+        SlabHeader *next = header->next;
+        Slab_release_span(slab, header);
+        header = next;
+    }
+    slab->large = NULL;
+    GrowableArena_reset(&slab->arena);
+}
+
+/**
+ * Release the memory of the slab allocator. After this call, it cannot be used anymore.
+ * @param slab The slab allocator to destroy
+ */
+void Slab_destroy(Slab *slab) {
+    if (slab == NULL) return;
+    for (size_t i = 0; i < SLAB_CLASSES; ++i)
+        slab->classes[i] = (SlabClass){0};
+    Slab_free_spans(slab->large);
+    slab->large = NULL;
+    for (size_t i = 0; i < SLAB_CACHED_SPANS; ++i) {
+        Slab_free_spans(slab->spans[i]);
+        slab->spans[i] = NULL;
+    }
+    GrowableArena_free(&slab->arena);
+}
+
+#endif
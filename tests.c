@@ -1,8 +1,33 @@
 #include <stdio.h>
 #include <assert.h>
+#include <stdalign.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "arena.c"
+#include "atomic_arena.c"
+#include "page_pool.c"
+#include "pool.c"
+#include "slab.c"
+#include "arena_str.c"
+#include "arena_vec.c"
+#include "arena_map.c"
+#include "arena_stream.c"
+#include "page_prefetch.c"
+
+// With ARENA_ALIGN_BY_DEFAULT every allocation is padded, exact fill levels only hold without it
+#ifdef ARENA_ALIGN_BY_DEFAULT
+#define ARENA_ALLOC_PADDED 1
+#else
+#define ARENA_ALLOC_PADDED 0
+#endif
 
 void test_arena(void) {
     // Simple Arena
@@ -26,8 +51,8 @@ void test_arena(void) {
 
     printf("Allocating 1 byte, this should not fail\n");
     const void* data3 = Arena_alloc(&arena, 1);
-    assert(data3 != NULL && "Arena alloc 3 should have not failed");
-    assert(Arena_remaining(&arena) == 0 && "Amount of available space should be 0");
+    assert((ARENA_ALLOC_PADDED || data3 != NULL) && "Arena alloc 3 should have not failed");
+    assert((ARENA_ALLOC_PADDED || Arena_remaining(&arena) == 0) && "Amount of available space should be 0");
 
     printf("Resetting arena\n");
     Arena_reset(&arena);
@@ -69,18 +94,1548 @@ void test_arena(void) {
     GrowableArena_reset(&garena);
     assert(GrowableArena_remaining(&garena) == 8192 && "Amount of available space should be 8192");
 
+    printf("Allocating 2 full pages, this should reuse the existing pages\n");
+    gdata = GrowableArena_alloc(&garena, 4096);
+    assert(gdata != NULL && "GArena alloc 3 should have not failed");
+    gdata = GrowableArena_alloc(&garena, 4096);
+    assert(gdata != NULL && "GArena alloc 4 should have not failed");
+    assert(garena.pages == 2 && "Arena should still have two pages");
+    assert(garena.current == garena.first->next && "Second page should be the active page");
+
+    printf("Allocating 1 byte, this should trigger a third page\n");
+    gdata = GrowableArena_alloc(&garena, 1);
+    assert(gdata != NULL && "GArena alloc 5 should have not failed");
+    assert(garena.pages == 3 && "Arena should have three pages");
+    assert(GrowableArena_remaining(&garena) == 4095 && "Amount of available space should be 4095");
+
+    printf("Allocating more than a page, this should create a large block\n");
+    ArenaPage* active = garena.current;
+    gdata = GrowableArena_alloc(&garena, 10000);
+    assert(gdata != NULL && "GArena alloc 6 should have not failed");
+    assert(garena.pages == 3 && "Arena should still have three pages");
+    assert(garena.large_blocks == 1 && "Arena should have one large block");
+    assert(garena.current == active && "Active page should not change");
+    assert(GrowableArena_remaining(&garena) == 4095 && "Amount of available space should be 4095");
+
+    printf("Allocating 1 byte, this should use the active page\n");
+    gdata = GrowableArena_alloc(&garena, 1);
+    assert(gdata != NULL && "GArena alloc 7 should have not failed");
+    assert((ARENA_ALLOC_PADDED || GrowableArena_remaining(&garena) == 4094) && "Amount of available space should be 4094");
+
+    printf("Resetting arena, this should release the large block\n");
+    GrowableArena_reset(&garena);
+    assert(garena.large == NULL && garena.large_blocks == 0 && "Arena should have no large blocks");
+    assert(GrowableArena_remaining(&garena) == 3 * 4096 && "Amount of available space should be 12288");
+
+    printf("Allocating a large block again\n");
+    gdata = GrowableArena_alloc(&garena, 10000);
+    assert(gdata != NULL && "GArena alloc 8 should have not failed");
+
     printf("Deallocating arena\n");
     GrowableArena_free(&garena);
-    assert(garena.base_arena == NULL && "Arena.base_arena should be NULL after free");
+    assert(garena.first == NULL && "Arena.first should be NULL after free");
 
     printf("Deallocating arena again\n");
     GrowableArena_free(&garena);
-    assert(garena.base_arena == NULL && "Arena.data should be NULL after free");
+    assert(garena.first == NULL && "Arena.first should be NULL after free");
+
+}
+
+void test_aligned_arena(void) {
+    printf("Testing aligned allocation\n");
+    Arena arena = {0};
+    if (!Arena_init(&arena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+
+    printf("Allocating 3 bytes, then 8 bytes aligned to 8\n");
+    const void* data1 = Arena_alloc(&arena, 3);
+    assert(data1 != NULL && "Arena alloc 1 failed");
+    const void* data2 = Arena_alloc_aligned(&arena, 8, 8);
+    assert(data2 != NULL && "Arena alloc 2 failed");
+    assert(((uintptr_t)data2 & 7) == 0 && "Allocation should be aligned to 8");
+
+    printf("Allocating with default alignment\n");
+    const void* data3 = Arena_alloc_aligned(&arena, 1, ARENA_DEFAULT_ALIGNMENT);
+    assert(data3 != NULL && "Arena alloc 3 failed");
+    assert(((uintptr_t)data3 % ARENA_DEFAULT_ALIGNMENT) == 0 && "Allocation should be aligned to max_align_t");
+
+    printf("Allocating with invalid alignments, this should fail\n");
+    assert(Arena_alloc_aligned(&arena, 8, 0) == NULL && "Alignment 0 should fail");
+    assert(Arena_alloc_aligned(&arena, 8, 24) == NULL && "Alignment 24 should fail");
+    assert(Arena_alloc_aligned(&arena, 8, 2 * ARENA_MAX_ALIGNMENT) == NULL && "Alignment above max should fail");
+
+    printf("Allocating more than the remaining space including padding, this should fail\n");
+    Arena_reset(&arena);
+    Arena_alloc(&arena, 1);
+    const size_t remaining = Arena_remaining(&arena);
+    assert(Arena_alloc_aligned(&arena, remaining, 64) == NULL && "Arena alloc 4 should have failed");
+    assert(Arena_remaining(&arena) == remaining && "Failed allocation should not consume space");
+    Arena_free(&arena);
+
+    printf("Testing aligned allocation in growable arena\n");
+    GrowableArena garena = {0};
+    if (!GrowableArena_init(&garena, 8192)) {
+        assert(false && "Arena init failed");
+    };
+    void* gdata = GrowableArena_alloc(&garena, 3);
+    assert(gdata != NULL && "GArena alloc 1 failed");
+    gdata = GrowableArena_alloc_aligned(&garena, 4096, 4096);
+    assert(gdata != NULL && "GArena alloc 2 failed");
+    assert(((uintptr_t)gdata & 4095) == 0 && "Allocation should be aligned to 4096");
+    gdata = GrowableArena_alloc_aligned(&garena, 4096, 4096);
+    assert(gdata != NULL && "GArena alloc 3 failed");
+    assert(((uintptr_t)gdata & 4095) == 0 && "Allocation should be aligned to 4096");
+
+    printf("Allocating a page with alignment 4096, this should create a large block\n");
+    gdata = GrowableArena_alloc_aligned(&garena, 8192, 4096);
+    assert(gdata != NULL && "GArena alloc 4 should have not failed");
+    assert(((uintptr_t)gdata & 4095) == 0 && "Allocation should be aligned to 4096");
+    assert(garena.large_blocks == 1 && "Arena should have one large block");
+    GrowableArena_free(&garena);
+
+#ifdef ARENA_ALIGN_BY_DEFAULT
+    printf("Allocating odd sizes, this should align every block by default\n");
+    if (!Arena_init(&arena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    for (size_t i = 1; i < 20; ++i) {
+        const void* data = Arena_alloc(&arena, i);
+        assert(data != NULL && ((uintptr_t)data % ARENA_DEFAULT_ALIGNMENT) == 0 && "Arena alloc should be aligned");
+    }
+    Arena_free(&arena);
+
+    if (!GrowableArena_init(&garena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    for (size_t i = 1; i < 200; ++i) {
+        // Odd sizes fill the active page and spill into new pages and large blocks
+        const void* gdata = GrowableArena_alloc(&garena, i * 13);
+        assert(gdata != NULL && ((uintptr_t)gdata % ARENA_DEFAULT_ALIGNMENT) == 0 && "GArena alloc should be aligned");
+    }
+    assert(garena.pages > 1 && garena.large_blocks > 0 && "Arena should have several pages and large blocks");
+    GrowableArena_free(&garena);
+
+#ifdef ARENA_HAS_MMAP
+    VirtualArena varena = {0};
+    if (!VirtualArena_init(&varena, 1024 * 1024, 0)) {
+        assert(false && "Arena init failed");
+    };
+    for (size_t i = 1; i < 20; ++i) {
+        const void* vdata = VirtualArena_alloc(&varena, i);
+        assert(vdata != NULL && ((uintptr_t)vdata % ARENA_DEFAULT_ALIGNMENT) == 0 && "VArena alloc should be aligned");
+    }
+    VirtualArena_free(&varena);
+#endif
+#endif
+}
+
+void test_growth_policy(void) {
+    printf("Testing growable arena with doubling pages\n");
+    GrowableArena garena = {0};
+    const GrowableArenaOptions options = {
+        .page_size = 1024,
+        .growth = ARENA_GROWTH_DOUBLE,
+        .max_page_size = 8192,
+    };
+    if (!GrowableArena_init_with_options(&garena, &options)) {
+        assert(false && "Arena init failed");
+    };
+
+    printf("Allocating 1024 byte blocks, pages should double up to 8192 bytes\n");
+    const size_t expected[] = {1024, 2048, 4096, 8192, 8192};
+    for (size_t i = 0; i < 1 + 2 + 4 + 8 + 8; ++i) {
+        void* gdata = GrowableArena_alloc(&garena, 1024);
+        assert(gdata != NULL && "GArena alloc should have not failed");
+    }
+    assert(garena.pages == 5 && "Arena should have five pages");
+    size_t i = 0;
+    for (const ArenaPage* page = garena.first; page != NULL; page = page->next, ++i)
+        assert(page->arena.capacity == expected[i] && "Unexpected page size");
+    assert(GrowableArena_remaining(&garena) == 0 && "Amount of available space should be 0");
+
+    printf("Resetting arena\n");
+    GrowableArena_reset(&garena);
+    assert(GrowableArena_remaining(&garena) == 23552 && "Amount of available space should be 23552");
+
+    printf("Allocating 2048 bytes, this should skip the first reused page\n");
+    void* gdata = GrowableArena_alloc(&garena, 2048);
+    assert(gdata != NULL && "GArena alloc should have not failed");
+    assert(garena.current == garena.first->next && "Second page should be the active page");
+    assert(garena.pages == 5 && "Arena should still have five pages");
+    GrowableArena_free(&garena);
+
+    printf("Testing growable arena with growth factor 1.5\n");
+    const GrowableArenaOptions factor_options = {
+        .page_size = 1000,
+        .growth = ARENA_GROWTH_FACTOR,
+        .growth_factor = 1.5,
+    };
+    if (!GrowableArena_init_with_options(&garena, &factor_options)) {
+        assert(false && "Arena init failed");
+    };
+    gdata = GrowableArena_alloc(&garena, 1000);
+    assert(gdata != NULL && "GArena alloc should have not failed");
+    gdata = GrowableArena_alloc(&garena, 1);
+    assert(gdata != NULL && "GArena alloc should have not failed");
+    assert(garena.current->arena.capacity == 1500 && "Second page should have 1500 bytes");
+    assert(garena.page_size == 2250 && "Next page should have 2250 bytes");
+    GrowableArena_free(&garena);
+}
+
+void test_virtual_arena(void) {
+#ifdef ARENA_HAS_MMAP
+    printf("Testing virtual arena\n");
+    printf("Reserving 1 GiB\n");
+    VirtualArena varena = {0};
+    if (!VirtualArena_init(&varena, 1024 * 1024 * 1024, VIRTUAL_ARENA_DECOMMIT_ON_RESET)) {
+        assert(false && "Arena init failed");
+    };
+    assert(varena.committed == 0 && "No memory should be committed yet");
+    assert(VirtualArena_remaining(&varena) == 1024 * 1024 * 1024 && "Amount of available space should be 1 GiB");
+
+    printf("Allocating 100 bytes\n");
+    char* vdata = VirtualArena_alloc(&varena, 100);
+    assert(vdata != NULL && "VArena alloc 1 failed");
+    assert(varena.committed == varena.commit_size && "One commit step should be committed");
+    memset(vdata, 0xAB, 100);
+
+    printf("Allocating 1 MiB aligned to 4096, this should commit more memory\n");
+    char* vdata2 = VirtualArena_alloc_aligned(&varena, 1024 * 1024, 4096);
+    assert(vdata2 != NULL && "VArena alloc 2 failed");
+    assert(((uintptr_t)vdata2 & 4095) == 0 && "Allocation should be aligned to 4096");
+    assert(varena.committed >= 4096 + 1024 * 1024 && "Allocation should be committed");
+    memset(vdata2, 0xCD, 1024 * 1024);
+    assert(vdata[99] == (char)0xAB && "Earlier allocation should not move");
+
+    printf("Rewinding to a mark\n");
+    const ArenaMark vmark = VirtualArena_mark(&varena);
+    assert(VirtualArena_alloc(&varena, 1000) != NULL && "VArena alloc failed");
+    VirtualArena_rewind(&varena, vmark);
+    assert(varena.next_offset == vmark.offset && "Rewind should restore the offset");
+
+    printf("Growing the last allocation\n");
+    char* vgrown = VirtualArena_alloc(&varena, 10);
+    assert(VirtualArena_realloc(&varena, vgrown, 10, 256 * 1024) == vgrown && "Last allocation should grow in place");
+
+    printf("Allocating more than the reservation, this should fail\n");
+    assert(VirtualArena_alloc(&varena, VirtualArena_remaining(&varena) + 1) == NULL && "VArena alloc 3 should have failed");
+
+    printf("Resetting arena, this should release the committed tail\n");
+    VirtualArena_reset(&varena);
+    assert(VirtualArena_remaining(&varena) == 1024 * 1024 * 1024 && "Amount of available space should be 1 GiB");
+    vdata2 = VirtualArena_alloc(&varena, 2 * 1024 * 1024);
+    assert(vdata2 != NULL && "VArena alloc 4 failed");
+#ifdef __linux__
+    assert(vdata2[512 * 1024] == 0 && "Released memory should read as zero");
+#endif
+
+    printf("Deallocating arena\n");
+    VirtualArena_free(&varena);
+    assert(varena.data == NULL && "VArena.data should be NULL after free");
+    VirtualArena_free(&varena);
+
+    printf("Reserving 64 MiB with huge pages\n");
+    if (!VirtualArena_init(&varena, 64 * 1024 * 1024, VIRTUAL_ARENA_HUGE_PAGES)) {
+        assert(false && "Arena init failed");
+    };
+    printf("Got backing: %s\n", ArenaBacking_name(VirtualArena_backing(&varena)));
+    assert(varena.commit_size == VIRTUAL_ARENA_HUGE_PAGE_SIZE && "Commit step should be a huge page");
+    if (VirtualArena_backing(&varena) != ARENA_BACKING_PAGES)
+        assert(((uintptr_t)varena.data & (VIRTUAL_ARENA_HUGE_PAGE_SIZE - 1)) == 0 && "Reservation should be aligned to a huge page");
+    vdata = VirtualArena_alloc(&varena, 3 * 1024 * 1024);
+    assert(vdata != NULL && "VArena alloc 5 failed");
+    memset(vdata, 0xEF, 3 * 1024 * 1024);
+    assert(varena.committed == 2 * VIRTUAL_ARENA_HUGE_PAGE_SIZE && "Two huge pages should be committed");
+    VirtualArena_free(&varena);
+    assert(varena.data == NULL && "VArena.data should be NULL after free");
+#endif
+}
+
+void test_page_retention(void) {
+    printf("Testing growable arena page retention\n");
+    GrowableArena garena = {0};
+    const GrowableArenaOptions options = {
+        .page_size = 1024,
+        .retain_pages = 4,
+        .retain_bytes = 3 * 1024,
+    };
+    if (!GrowableArena_init_with_options(&garena, &options)) {
+        assert(false && "Arena init failed");
+    };
+
+    printf("Allocating 10 pages\n");
+    for (size_t i = 0; i < 10; ++i) {
+        void* gdata = GrowableArena_alloc(&garena, 1024);
+        assert(gdata != NULL && "GArena alloc should have not failed");
+    }
+    assert(garena.pages == 10 && "Arena should have ten pages");
+
+    printf("Resetting arena, this should keep 3 pages\n");
+    GrowableArena_reset(&garena);
+    assert(garena.pages == 3 && "Arena should have three pages");
+    assert(GrowableArena_remaining(&garena) == 3 * 1024 && "Amount of available space should be 3072");
+
+    printf("Allocating 4 pages, this should reuse the kept pages\n");
+    for (size_t i = 0; i < 4; ++i) {
+        void* gdata = GrowableArena_alloc(&garena, 1024);
+        assert(gdata != NULL && "GArena alloc should have not failed");
+    }
+    assert(garena.pages == 4 && "Arena should have four pages");
+    GrowableArena_free(&garena);
+}
+
+void test_mark_rewind(void) {
+    printf("Testing arena mark and rewind\n");
+    Arena arena = {0};
+    if (!Arena_init(&arena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    Arena_alloc(&arena, 100);
+    const ArenaMark mark = Arena_mark(&arena);
+    for (size_t i = 0; i < 10; ++i) {
+        void* data = Arena_alloc(&arena, 50);
+        assert(data != NULL && "Arena alloc should have not failed");
+    }
+    assert((ARENA_ALLOC_PADDED || Arena_remaining(&arena) == 424) && "Amount of available space should be 424");
+    Arena_rewind(&arena, mark);
+    assert(Arena_remaining(&arena) == 924 && "Amount of available space should be 924");
+    Arena_free(&arena);
+
+    printf("Testing growable arena mark and rewind across pages\n");
+    GrowableArena garena = {0};
+    if (!GrowableArena_init(&garena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    char* first = GrowableArena_alloc(&garena, 1000);
+    first[999] = 'x';
+    const GrowableArenaMark gmark = GrowableArena_mark(&garena);
+
+    printf("Filling 3 more pages and a large block\n");
+    for (size_t i = 0; i < 3; ++i) {
+        void* gdata = GrowableArena_alloc(&garena, 1000);
+        assert(gdata != NULL && "GArena alloc should have not failed");
+    }
+    void* large = GrowableArena_alloc(&garena, 5000);
+    assert(large != NULL && "GArena large alloc should have not failed");
+    assert(garena.pages == 4 && garena.large_blocks == 1 && "Arena should have four pages and a large block");
+
+    printf("Rewinding to the mark\n");
+    GrowableArena_rewind(&garena, gmark);
+    assert(garena.current == garena.first && "First page should be the active page");
+    assert(garena.large_blocks == 0 && garena.large == NULL && "Large block should be released");
+    assert(GrowableArena_remaining(&garena) == 24 + 3 * 1024 && "Amount of available space should be 3096");
+    assert(first[999] == 'x' && "Memory before the mark should be kept");
+
+    printf("Allocating again, this should reuse the pages\n");
+    for (size_t i = 0; i < 3; ++i) {
+        void* gdata = GrowableArena_alloc(&garena, 1000);
+        assert(gdata != NULL && "GArena alloc should have not failed");
+    }
+    assert(garena.pages == 4 && "Arena should still have four pages");
+    GrowableArena_free(&garena);
+}
+
+void test_realloc(void) {
+    printf("Testing arena realloc\n");
+    Arena arena = {0};
+    if (!Arena_init(&arena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    char* data = Arena_realloc(&arena, NULL, 0, 10);
+    assert(data != NULL && "Arena realloc 1 failed");
+    memcpy(data, "0123456789", 10);
+
+    printf("Growing the last allocation, this should not move\n");
+    char* grown = Arena_realloc(&arena, data, 10, 100);
+    assert(grown == data && "Last allocation should grow in place");
+    assert(Arena_remaining(&arena) == 1024 - 100 && "Amount of available space should be 924");
+
+    printf("Shrinking the last allocation, this should not move\n");
+    grown = Arena_realloc(&arena, data, 100, 20);
+    assert(grown == data && "Last allocation should shrink in place");
+    assert(Arena_remaining(&arena) == 1024 - 20 && "Amount of available space should be 1004");
+
+    printf("Growing an earlier allocation, this should copy\n");
+    Arena_alloc(&arena, 1);
+    char* moved = Arena_realloc(&arena, data, 20, 40);
+    assert(moved != NULL && moved != data && "Earlier allocation should move");
+    assert(((uintptr_t)moved % ARENA_DEFAULT_ALIGNMENT) == 0 && "Moved block should be aligned");
+    assert(memcmp(moved, "0123456789", 10) == 0 && "Contents should be copied");
+
+    printf("Growing beyond the capacity, this should fail\n");
+    assert(Arena_realloc(&arena, moved, 40, 2048) == NULL && "Arena realloc should have failed");
+    Arena_free(&arena);
+
+    printf("Testing growable arena realloc\n");
+    GrowableArena garena = {0};
+    if (!GrowableArena_init(&garena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    char* gdata = GrowableArena_realloc(&garena, NULL, 0, 10);
+    memcpy(gdata, "0123456789", 10);
+    for (size_t size = 20; size <= 1000; size += 10) {
+        char* ggrown = GrowableArena_realloc(&garena, gdata, size - 10, size);
+        assert(ggrown == gdata && "Last allocation should grow in place");
+    }
+    assert(garena.pages == 1 && "Arena should still have one page");
+
+    printf("Growing beyond the page, this should move to a large block\n");
+    char* glarge = GrowableArena_realloc(&garena, gdata, 1000, 4000);
+    assert(glarge != NULL && glarge != gdata && "Allocation should move");
+    assert(garena.large_blocks == 1 && "Arena should have one large block");
+    assert(memcmp(glarge, "0123456789", 10) == 0 && "Contents should be copied");
+
+    printf("Growing the large block, this should resize it\n");
+    glarge = GrowableArena_realloc(&garena, glarge, 4000, 100000);
+    assert(glarge != NULL && "GArena realloc failed");
+    assert(garena.large_blocks == 1 && "Arena should still have one large block");
+    assert(memcmp(glarge, "0123456789", 10) == 0 && "Contents should be kept");
+    glarge[99999] = 'x';
+    GrowableArena_free(&garena);
+}
+
+#define ATOMIC_TEST_THREADS 8
+#define ATOMIC_TEST_ALLOCS 10000
+
+typedef struct {
+    AtomicGrowableArena* garena;
+    unsigned char tag;
+} AtomicTestWorker;
+
+static void *atomic_test_worker(void *arg) {
+    AtomicGrowableArena* garena = ((AtomicTestWorker*)arg)->garena;
+    const unsigned char tag = ((AtomicTestWorker*)arg)->tag;
+    unsigned char** blocks = malloc(sizeof(unsigned char*) * ATOMIC_TEST_ALLOCS);
+    for (size_t i = 0; i < ATOMIC_TEST_ALLOCS; ++i) {
+        blocks[i] = AtomicGrowableArena_alloc_aligned(garena, 24, 8);
+        assert(blocks[i] != NULL && "AGArena alloc should have not failed");
+        memset(blocks[i], tag, 24);
+    }
+    for (size_t i = 0; i < ATOMIC_TEST_ALLOCS; ++i)
+        for (size_t j = 0; j < 24; ++j)
+            assert(blocks[i][j] == tag && "Allocations of different threads should not overlap");
+    free(blocks);
+    return NULL;
+}
+
+void test_atomic_arena(void) {
+    printf("Testing atomic arena\n");
+    AtomicArena arena = {0};
+    if (!AtomicArena_init(&arena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    assert(AtomicArena_alloc(&arena, 1000) != NULL && "AArena alloc 1 failed");
+    assert(AtomicArena_remaining(&arena) == 24 && "Amount of available space should be 24");
+    const void* data = AtomicArena_alloc_aligned(&arena, 8, 8);
+    assert(data != NULL && ((uintptr_t)data & 7) == 0 && "AArena alloc 2 failed");
+    assert(AtomicArena_alloc(&arena, 100) == NULL && "AArena alloc 3 should have failed");
+    assert((ARENA_ALLOC_PADDED || AtomicArena_remaining(&arena) == 0) && "Full arena should report no space");
+    AtomicArena_reset(&arena);
+    assert(AtomicArena_remaining(&arena) == 1024 && "Amount of available space should be 1024");
+    AtomicArena_free(&arena);
+    assert(arena.data == NULL && "AArena.data should be NULL after free");
+
+    printf("Testing atomic growable arena with %d threads\n", ATOMIC_TEST_THREADS);
+    AtomicGrowableArena garena = {0};
+    if (!AtomicGrowableArena_init(&garena, 4096)) {
+        assert(false && "Arena init failed");
+    };
+    pthread_t threads[ATOMIC_TEST_THREADS];
+    AtomicTestWorker workers[ATOMIC_TEST_THREADS];
+    for (size_t i = 0; i < ATOMIC_TEST_THREADS; ++i) {
+        workers[i] = (AtomicTestWorker){ .garena = &garena, .tag = (unsigned char)(i + 1) };
+        pthread_create(&threads[i], NULL, atomic_test_worker, &workers[i]);
+    }
+    for (size_t i = 0; i < ATOMIC_TEST_THREADS; ++i)
+        pthread_join(threads[i], NULL);
+    assert(garena.pages >= ATOMIC_TEST_THREADS * ATOMIC_TEST_ALLOCS * 24 / 4096 && "Arena should have grown");
+
+    printf("Allocating a large block\n");
+    assert(AtomicGrowableArena_alloc(&garena, 10000) != NULL && "AGArena large alloc failed");
+    assert(garena.large != NULL && "Arena should have a large block");
+
+    printf("Resetting arena, this should keep one page\n");
+    AtomicGrowableArena_reset(&garena);
+    assert(garena.pages == 1 && garena.large == NULL && "Arena should have one page");
+    assert(AtomicGrowableArena_remaining(&garena) == 4096 && "Amount of available space should be 4096");
+    AtomicGrowableArena_free(&garena);
+    assert(garena.current == NULL && "AGArena.current should be NULL after free");
+}
+
+#define POOL_TEST_THREADS 4
+
+static void *page_pool_test_worker(void *arg) {
+    PagePool* pool = arg;
+    GrowableArena* garena = PagePool_thread_arena(pool);
+    assert(garena != NULL && "Thread arena should be created");
+    assert(PagePool_thread_arena(pool) == garena && "Thread arena should be reused");
+    for (size_t round = 0; round < 10; ++round) {
+        for (size_t i = 0; i < 16; ++i) {
+            char* gdata = GrowableArena_alloc(garena, 1024);
+            assert(gdata != NULL && "GArena alloc should have not failed");
+            memset(gdata, (int)i, 1024);
+        }
+        GrowableArena_reset(garena);
+    }
+    return NULL;
+}
+
+void test_page_pool(void) {
+    printf("Testing page pool\n");
+    PagePool pool;
+    if (!PagePool_init(&pool, 4096, 2)) {
+        assert(false && "Pool init failed");
+    };
+
+    printf("Allocating 8 pages from the thread arena\n");
+    GrowableArena* garena = PagePool_thread_arena(&pool);
+    assert(garena != NULL && "Thread arena should be created");
+    for (size_t i = 0; i < 8; ++i) {
+        void* gdata = GrowableArena_alloc(garena, 4096);
+        assert(gdata != NULL && "GArena alloc should have not failed");
+    }
+    assert(garena->pages == 8 && "Arena should have eight pages");
+    assert(PagePool_free_pages(&pool) == 0 && "Pool should have no free pages");
+
+    printf("Resetting the thread arena, this should return 6 pages to the pool\n");
+    GrowableArena_reset(garena);
+    assert(garena->pages == 2 && "Arena should keep two pages");
+    assert(PagePool_free_pages(&pool) == 6 && "Pool should have six free pages");
+
+    printf("Allocating 4 pages, this should reuse pooled pages\n");
+    for (size_t i = 0; i < 4; ++i)
+        GrowableArena_alloc(garena, 4096);
+    assert(PagePool_free_pages(&pool) == 4 && "Pool should have four free pages");
+
+    printf("Allocating a large block, this should bypass the pool\n");
+    assert(GrowableArena_alloc(garena, 10000) != NULL && "GArena large alloc failed");
+    GrowableArena_reset(garena);
+    assert(PagePool_free_pages(&pool) == 6 && "Pool should have six free pages");
+
+    printf("Running %d threads with their own arenas\n", POOL_TEST_THREADS);
+    pthread_t threads[POOL_TEST_THREADS];
+    for (size_t i = 0; i < POOL_TEST_THREADS; ++i)
+        pthread_create(&threads[i], NULL, page_pool_test_worker, &pool);
+    for (size_t i = 0; i < POOL_TEST_THREADS; ++i)
+        pthread_join(threads[i], NULL);
+    assert(PagePool_free_pages(&pool) >= 6 && "Exited threads should return their pages");
+
+    printf("Releasing the thread arena\n");
+    PagePool_release_thread_arena(&pool);
+    assert(PagePool_free_pages(&pool) >= 8 && "Released arena should return its pages");
+    PagePool_free(&pool);
+}
+
+void test_pool(void) {
+    printf("Testing object pool\n");
+    Pool pool = {0};
+    if (!Pool_init(&pool, 24, 16, 0)) {
+        assert(false && "Pool init failed");
+    };
+    assert(pool.slot_size == 32 && "Slot size should be rounded up to the alignment");
+
+    printf("Allocating 20 objects, this should take two pages\n");
+    void* objects[20];
+    for (size_t i = 0; i < 20; ++i) {
+        objects[i] = Pool_alloc(&pool);
+        assert(objects[i] != NULL && "Pool alloc should have not failed");
+        assert(((uintptr_t)objects[i] % ARENA_DEFAULT_ALIGNMENT) == 0 && "Object should be aligned");
+        memset(objects[i], (int)i, 24);
+    }
+    assert(pool.arena.pages == 2 && "Pool should have two pages");
+
+    printf("Freeing and allocating, this should reuse the freed slot\n");
+    Pool_free(&pool, objects[3]);
+    Pool_free(&pool, objects[7]);
+    assert(Pool_alloc(&pool) == objects[7] && "Last freed slot should be reused first");
+    assert(Pool_alloc(&pool) == objects[3] && "Freed slot should be reused");
+    assert(((unsigned char*)objects[4])[0] == 4 && "Neighbouring objects should be untouched");
+    Pool_free(&pool, NULL);
+
+    printf("Resetting pool\n");
+    Pool_reset(&pool);
+    assert(Pool_alloc(&pool) == objects[0] && "Reset pool should start at the first slot");
+    Pool_destroy(&pool);
+    assert(pool.arena.first == NULL && "Pool arena should be freed");
+
+    printf("Testing cache aligned object pool\n");
+    if (!Pool_init(&pool, 40, 8, POOL_CACHE_ALIGNED)) {
+        assert(false && "Pool init failed");
+    };
+    for (size_t i = 0; i < 20; ++i) {
+        void* object = Pool_alloc(&pool);
+        assert(object != NULL && ((uintptr_t)object % POOL_CACHE_LINE_SIZE) == 0 && "Object should be cache aligned");
+    }
+    assert(pool.arena.pages == 3 && "Pool should have three pages");
+    Pool_destroy(&pool);
+}
+
+void test_slab(void) {
+    printf("Testing slab allocator\n");
+    Slab slab = {0};
+    if (!Slab_init(&slab)) {
+        assert(false && "Slab init failed");
+    };
+
+    printf("Allocating blocks of all size classes\n");
+    void* blocks[SLAB_CLASSES];
+    for (size_t i = 0; i < SLAB_CLASSES; ++i) {
+        const size_t size = ((size_t)SLAB_MIN_SIZE << i) - 1;
+        blocks[i] = Slab_alloc(&slab, size);
+        assert(blocks[i] != NULL && "Slab alloc should have not failed");
+        assert(((uintptr_t)blocks[i] % ARENA_DEFAULT_ALIGNMENT) == 0 && "Block should be aligned");
+        assert(Slab_size(blocks[i]) == (size_t)SLAB_MIN_SIZE << i && "Block should have the class size");
+        memset(blocks[i], (int)i, size);
+    }
+    assert(slab.arena.pages == SLAB_CLASSES && "Every size class should have its own slab");
+
+    printf("Freeing a block, this should reuse it for the same class\n");
+    Slab_free(blocks[2]);
+    assert(Slab_alloc(&slab, 60) == blocks[2] && "Freed block should be reused");
+    assert(Slab_alloc(&slab, 30) != blocks[2] && "Other classes should not reuse the block");
+
+    printf("Filling a slab, this should add another one\n");
+    for (size_t i = 0; i < 20; ++i)
+        assert(Slab_alloc(&slab, 4096) != NULL && "Slab alloc should have not failed");
+    assert(slab.arena.pages == SLAB_CLASSES + 1 && "4096 byte class should have two slabs");
+
+    printf("Allocating and freeing a large block\n");
+    char* large = Slab_alloc(&slab, 100000);
+    assert(large != NULL && slab.large != NULL && "Slab large alloc failed");
+    assert(Slab_size(large) == 100000 && "Large block should have the requested size");
+    large[99999] = 'x';
+    Slab_free(large);
+    assert(slab.large == NULL && "Large block should be released");
+    Slab_free(NULL);
+
+    printf("Allocating and freeing large blocks repeatedly, this should reuse the spans\n");
+    for (int i = 0; i < 100; ++i) {
+        char* again = Slab_alloc(&slab, 70000 + (size_t)i * 100);
+        assert(again == large && "A freed span of the same length should be reused");
+        assert(Slab_size(again) == 70000 + (size_t)i * 100 && "Reused block should have the requested size");
+        Slab_free(again);
+    }
+    char* other = Slab_alloc(&slab, 200000);
+    assert(other != NULL && other != large && "A longer block should get a span of its own");
+    Slab_free(other);
+    char* huge = Slab_alloc(&slab, 2 * 1024 * 1024);
+    assert(huge != NULL && "Slab large alloc failed");
+    huge[2 * 1024 * 1024 - 1] = 'x';
+    Slab_free(huge);
+
+    printf("Resetting slab allocator\n");
+    char* live = Slab_alloc(&slab, 100000);
+    assert(live == large && "Slab large alloc failed");
+    Slab_reset(&slab);
+    assert(slab.large == NULL && "Reset should release large blocks");
+    assert(Slab_alloc(&slab, 100000) == live && "Reset should keep large spans for reuse");
+    void* block = Slab_alloc(&slab, 16);
+    assert(block != NULL && Slab_size(block) == 16 && "Slab alloc after reset failed");
+    Slab_destroy(&slab);
+}
+
+typedef struct {
+    double x, y;
+    int id;
+} TestNode;
+
+void test_bulk_alloc(void) {
+    printf("Testing bulk allocation\n");
+    Arena arena = {0};
+    if (!Arena_init(&arena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    Arena_alloc(&arena, 3);
+    TestNode* nodes = Arena_alloc_array(&arena, 10, sizeof(TestNode), alignof(TestNode));
+    assert(nodes != NULL && ((uintptr_t)nodes % alignof(TestNode)) == 0 && "Arena array alloc failed");
+    for (int i = 0; i < 10; ++i) nodes[i].id = i;
+    assert(Arena_alloc_array(&arena, SIZE_MAX / 2, 4, 1) == NULL && "Overflowing array should fail");
+    Arena_free(&arena);
+
+    printf("Allocating 1000 nodes in batches\n");
+    GrowableArena garena = {0};
+    if (!GrowableArena_init(&garena, 4096)) {
+        assert(false && "Arena init failed");
+    };
+    size_t total = 0, batches = 0;
+    while (total < 1000) {
+        size_t allocated = 0;
+        TestNode* batch = GrowableArena_alloc_batch(&garena, 1000 - total, sizeof(TestNode), alignof(TestNode), &allocated);
+        assert(batch != NULL && allocated > 0 && "GArena batch alloc failed");
+        assert(((uintptr_t)batch % alignof(TestNode)) == 0 && "Batch should be aligned");
+        for (size_t i = 0; i < allocated; ++i) batch[i].id = (int)(total + i);
+        total += allocated;
+        batches++;
+    }
+    const size_t per_page = 4096 / sizeof(TestNode);
+    assert(batches == (1000 + per_page - 1) / per_page && "Every batch should fill a page");
+    assert(garena.pages == batches && "Arena should have one page per batch");
+
+    printf("Allocating an array larger than a page\n");
+    TestNode* array = GrowableArena_alloc_array(&garena, 1000, sizeof(TestNode), alignof(TestNode));
+    assert(array != NULL && garena.large_blocks == 1 && "Large array should get a large block");
+    array[999].id = 999;
+    GrowableArena_free(&garena);
+}
 
+#ifdef ARENA_DEBUG
+/**
+ * Runs a function in a child process.
+ * @return true if the child was aborted, or failed under a memory checker
+ */
+static bool aborts(void (*function)(void)) {
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        function();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+#ifdef ARENA_SANITIZE
+    return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+#else
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+#endif
+}
+
+static void overflow_and_reset(void) {
+    Arena arena = {0};
+    Arena_init(&arena, 1024);
+    char* data = Arena_alloc(&arena, 10);
+    data[10] = 'x';
+    Arena_reset(&arena);
+}
+
+static void overflow_and_rewind(void) {
+    GrowableArena arena = {0};
+    GrowableArena_init(&arena, 1024);
+    const GrowableArenaMark mark = GrowableArena_mark(&arena);
+    char* data = GrowableArena_alloc_aligned(&arena, 100, 8);
+    data[100] = 'x';
+    GrowableArena_rewind(&arena, mark);
+}
+
+void test_debug_checks(void) {
+    printf("Testing debug checks\n");
+    assert(Arena_alloc(NULL, 10) == NULL && "Debug builds should check the arena");
+    assert(GrowableArena_alloc(NULL, 10) == NULL && "Debug builds should check the arena");
+
+    Arena arena = {0};
+    if (!Arena_init(&arena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    printf("Allocating, this should fill the memory and add guard bytes\n");
+    unsigned char* data = Arena_alloc(&arena, 10);
+    assert(data != NULL && data[0] == ARENA_FRESH_BYTE && data[9] == ARENA_FRESH_BYTE && "Fresh memory should be filled");
+#ifndef ARENA_SANITIZE
+    assert(data[10] == ARENA_GUARD_BYTE && "Guard bytes should follow the allocation");
+#endif
+    assert(Arena_remaining(&arena) == 1024 - 10 - ARENA_ALLOC_OVERHEAD && "Allocation should take the overhead");
+    assert(Arena_alloc(&arena, SIZE_MAX) == NULL && "Huge allocation should fail");
+    assert(Arena_alloc_aligned(&arena, SIZE_MAX - 8, 8) == NULL && "Huge allocation should fail");
+
+    printf("Resizing in place, this should move the guard bytes\n");
+    assert(Arena_realloc(&arena, data, 10, 20) == data && "Last allocation should grow in place");
+    assert(data[10] == ARENA_FRESH_BYTE && "Grown memory should be filled");
+#ifndef ARENA_SANITIZE
+    assert(data[20] == ARENA_GUARD_BYTE && "Guard bytes should move");
+#endif
+
+    printf("Rewinding and resetting, this should poison the memory\n");
+    const ArenaMark mark = Arena_mark(&arena);
+    unsigned char* data2 = Arena_alloc(&arena, 100);
+    memset(data2, 0, 100);
+    Arena_rewind(&arena, mark);
+#ifndef ARENA_SANITIZE
+    assert(data2[50] == ARENA_POISON_BYTE && "Rewound memory should be poisoned");
+#endif
+    assert(data[0] == ARENA_FRESH_BYTE && "Memory before the mark should be untouched");
+    Arena_reset(&arena);
+#ifndef ARENA_SANITIZE
+    assert(data[0] == ARENA_POISON_BYTE && "Reset memory should be poisoned");
+#endif
+    Arena_free(&arena);
+
+    printf("Writing past the end of allocations, this should abort\n");
+    assert(aborts(overflow_and_reset) && "Reset should detect the overwritten guard bytes");
+    assert(aborts(overflow_and_rewind) && "Rewind should detect the overwritten guard bytes");
+}
+#endif
+
+void test_arena_str(void) {
+    printf("Testing string builder\n");
+    GrowableArena arena = {0};
+    if (!GrowableArena_init(&arena, 4096)) {
+        assert(false && "Arena init failed");
+    };
+    ArenaStr str;
+    if (!ArenaStr_init(&str, &arena)) {
+        assert(false && "String init failed");
+    };
+    assert(ArenaStr_append_cstr(&str, "hello") && ArenaStr_append_char(&str, ' ') && "Append failed");
+    char* first = str.data;
+    for (int i = 0; i < 100; ++i)
+        assert(ArenaStr_appendf(&str, "%d,", i) && "Appendf failed");
+    assert(str.data == first && "The most recent allocation should grow in place");
+    assert(strncmp(str.data, "hello 0,1,2,", 12) == 0 && str.data[str.length] == '\0' && "String should be built");
+    const size_t length = str.length;
+    const size_t remaining = GrowableArena_remaining(&arena);
+    const char* built = ArenaStr_finish(&str);
+    assert(built == first && strlen(built) == length && "Finish should return the string");
+    assert(GrowableArena_remaining(&arena) > remaining && "Finish should hand back the unused capacity");
+
+    printf("Building a string bigger than a page\n");
+    for (int i = 0; i < 1000; ++i)
+        assert(ArenaStr_append(&str, "0123456789", 10) && "Append failed");
+    assert(str.length == 10000 && strlen(ArenaStr_finish(&str)) == 10000 && "Big string should be built");
+    assert(strcmp(ArenaStr_finish(&str), "") == 0 && "Empty string should be built");
+
+    printf("Testing intern table\n");
+    ArenaInternTable table;
+    if (!ArenaInternTable_init(&table, &arena, 4)) {
+        assert(false && "Table init failed");
+    };
+    const char* hello = ArenaInternTable_intern_cstr(&table, "hello");
+    char buffer[] = "hello world";
+    assert(hello != NULL && ArenaInternTable_intern(&table, buffer, 5) == hello && "Equal strings should intern once");
+    assert(ArenaInternTable_find(&table, "nope", 4) == NULL && "Unknown string should not be found");
+    assert(ArenaInternTable_intern(&table, "", 0) != NULL && "Empty string should be interned");
+
+    printf("Interning 10000 strings, this should grow the table\n");
+    const char* interned[10000];
+    for (int i = 0; i < 10000; ++i) {
+        char key[32];
+        const int key_length = snprintf(key, sizeof(key), "key-%d", i);
+        interned[i] = ArenaInternTable_intern(&table, key, (size_t)key_length);
+        assert(interned[i] != NULL && strcmp(interned[i], key) == 0 && "Intern failed");
+    }
+    assert(table.count == 10002 && table.capacity >= 10002 / 3 * 4 && "Table should have grown");
+    for (int i = 0; i < 10000; ++i) {
+        char key[32];
+        const int key_length = snprintf(key, sizeof(key), "key-%d", i);
+        assert(ArenaInternTable_find(&table, key, (size_t)key_length) == interned[i] && "Interned string should be found");
+    }
+    assert(ArenaInternTable_find(&table, "hello", 5) == hello && "Strings should survive growth");
+    GrowableArena_free(&arena);
+}
+
+ARENA_VEC_DECLARE(IntVec, int)
+
+static uint64_t hash_id(const uint64_t* key) { return ArenaMap_hash_u64(*key); }
+static bool equal_id(const uint64_t* a, const uint64_t* b) { return *a == *b; }
+ARENA_MAP_DECLARE(IdMap, uint64_t, int, hash_id, equal_id)
+ARENA_MAP_DECLARE(NameMap, const char*, int, ArenaMap_hash_string, ArenaMap_equal_string)
+
+void test_containers(void) {
+    printf("Testing arena vector\n");
+    GrowableArena arena = {0};
+    if (!GrowableArena_init(&arena, 4096)) {
+        assert(false && "Arena init failed");
+    };
+    IntVec vec;
+    if (!IntVec_init(&vec, &arena, 0)) {
+        assert(false && "Vector init failed");
+    };
+    for (int i = 0; i < 10000; ++i)
+        assert(IntVec_push(&vec, i) && "Push failed");
+    assert(vec.length == 10000 && vec.capacity >= 10000 && "Vector should have grown");
+    for (int i = 0; i < 10000; ++i)
+        assert(*IntVec_at(&vec, (size_t)i) == i && "Items should survive growth");
+    assert(IntVec_at(&vec, 10000) == NULL && "Out of bounds access should fail");
+    const int more[] = {1, 2, 3};
+    assert(IntVec_append(&vec, more, 3) && vec.length == 10003 && "Append failed");
+    int last;
+    assert(IntVec_pop(&vec, &last) && last == 3 && vec.length == 10002 && "Pop failed");
+    IntVec_clear(&vec);
+    assert(!IntVec_pop(&vec, &last) && "Pop from an empty vector should fail");
+
+    printf("Testing arena hash map\n");
+    IdMap map;
+    if (!IdMap_init(&map, &arena, 0)) {
+        assert(false && "Map init failed");
+    };
+    for (uint64_t i = 0; i < 10000; ++i)
+        assert(IdMap_put(&map, i * 7, (int)i) != NULL && "Put failed");
+    assert(map.count == 10000 && map.capacity / 8 * 7 >= 10000 && "Map should have grown");
+    for (uint64_t i = 0; i < 10000; ++i)
+        assert(IdMap_get(&map, i * 7) != NULL && *IdMap_get(&map, i * 7) == (int)i && "Entries should survive growth");
+    assert(IdMap_get(&map, 1) == NULL && "Unknown key should not be found");
+    assert(*IdMap_put(&map, 0, -1) == -1 && map.count == 10000 && "Put should replace the value");
+    for (uint64_t i = 0; i < 10000; i += 2)
+        assert(IdMap_remove(&map, i * 7) && "Remove failed");
+    assert(!IdMap_remove(&map, 0) && map.count == 5000 && "Removed key should be gone");
+    for (uint64_t i = 0; i < 10000; ++i)
+        assert((IdMap_get(&map, i * 7) != NULL) == (i % 2 == 1) && "Only odd keys should remain");
+    size_t index = 0, seen = 0;
+    for (IdMapEntry* entry = IdMap_next(&map, &index); entry != NULL; entry = IdMap_next(&map, &index))
+        seen += entry->key % 2 == 1 ? 1 : 0;
+    assert(seen == 5000 && "Iteration should visit every entry");
+
+    printf("Churning keys, this should reuse deleted slots\n");
+    const size_t capacity = map.capacity;
+    for (uint64_t round = 0; round < 20; ++round) {
+        for (uint64_t i = 0; i < 1000; ++i)
+            assert(IdMap_put(&map, 1000000 + round * 1000 + i, 0) != NULL && "Put failed");
+        for (uint64_t i = 0; i < 1000; ++i)
+            assert(IdMap_remove(&map, 1000000 + round * 1000 + i) && "Remove failed");
+    }
+    assert(map.count == 5000 && map.capacity == capacity && "Churn should not grow the map");
+    IdMap_clear(&map);
+    assert(map.count == 0 && IdMap_get(&map, 7) == NULL && "Clear should remove all entries");
+
+    NameMap names;
+    if (!NameMap_init(&names, &arena, 4)) {
+        assert(false && "Map init failed");
+    };
+    char key[] = "alpha";
+    assert(NameMap_put(&names, "alpha", 1) && NameMap_put(&names, "beta", 2) && "Put failed");
+    assert(*NameMap_get(&names, key) == 1 && NameMap_get(&names, "gamma") == NULL && "String keys should compare by value");
+    GrowableArena_free(&arena);
+}
+
+static bool is_mapped(const void* ptr, const size_t size) {
+    const uintptr_t page = (uintptr_t)ptr & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+    return msync((void*)page, size + ((uintptr_t)ptr - page), MS_ASYNC) == 0;
+}
+
+void test_file_loading(void) {
+    printf("Testing file loading\n");
+    char path[] = "/tmp/arena-test-XXXXXX";
+    const int fd = mkstemp(path);
+    assert(fd >= 0 && "Temporary file failed");
+    char contents[10000];
+    for (size_t i = 0; i < sizeof(contents); ++i) contents[i] = (char)('a' + i % 26);
+    assert(write(fd, contents, sizeof(contents)) == (ssize_t)sizeof(contents) && "Write failed");
+    close(fd);
+
+    Arena arena = {0};
+    if (!Arena_init(&arena, 16384)) {
+        assert(false && "Arena init failed");
+    };
+    size_t size = 0;
+    const char* data = Arena_read_file(&arena, path, 64, &size);
+    assert(data != NULL && (uintptr_t)data % 64 == 0 && "Read should return an aligned block");
+    assert(size == sizeof(contents) && memcmp(data, contents, size) == 0 && data[size] == '\0' && "Read should load the file");
+    const size_t remaining = Arena_remaining(&arena);
+    assert(Arena_read_file(&arena, path, 64, &size) == NULL && Arena_remaining(&arena) == remaining && "A file that does not fit should leave the arena as it was");
+    assert(Arena_read_file(&arena, "/nonexistent/file", 64, &size) == NULL && "A missing file should fail");
+    assert(Arena_read_file(&arena, "/tmp", 64, &size) == NULL && "A directory should fail");
+
+    printf("Mapping a file, rewinding should unmap it\n");
+    const ArenaMark mark = Arena_mark(&arena);
+    const char* mapped = Arena_map_file(&arena, path, &size);
+    assert(mapped != NULL && size == sizeof(contents) && memcmp(mapped, contents, size) == 0 && "Map should load the file");
+    assert(is_mapped(mapped, size) && "File should be mapped");
+    Arena_rewind(&arena, mark);
+    assert(!is_mapped(mapped, size) && "Rewind should unmap the file");
+    mapped = Arena_map_file(&arena, path, &size);
+    Arena_reset(&arena);
+    assert(!is_mapped(mapped, size) && "Reset should unmap the file");
+    mapped = Arena_map_file(&arena, path, &size);
+    Arena_free(&arena);
+    assert(!is_mapped(mapped, size) && "Free should unmap the file");
+
+    printf("Loading files into a growable arena\n");
+    GrowableArena growable = {0};
+    if (!GrowableArena_init(&growable, 4096)) {
+        assert(false && "Arena init failed");
+    };
+    data = GrowableArena_read_file(&growable, path, 64, &size);
+    assert(data != NULL && size == sizeof(contents) && memcmp(data, contents, size) == 0 && data[size] == '\0' && "Read should load the file into a large block");
+    const GrowableArenaMark growable_mark = GrowableArena_mark(&growable);
+    const char* first = GrowableArena_map_file(&growable, path, &size);
+    const char* second = GrowableArena_map_file(&growable, path, &size);
+    assert(first != NULL && second != NULL && memcmp(second, contents, size) == 0 && "Map should load the file");
+    GrowableArena_rewind(&growable, growable_mark);
+    assert(!is_mapped(first, size) && !is_mapped(second, size) && "Rewind should unmap the files");
+    mapped = GrowableArena_map_file(&growable, path, &size);
+    GrowableArena_free(&growable);
+    assert(!is_mapped(mapped, size) && "Free should unmap the file");
+    unlink(path);
+}
+
+void test_stream(void) {
+    printf("Testing chunked stream\n");
+    GrowableArena arena = {0};
+    if (!GrowableArena_init(&arena, 4096)) {
+        assert(false && "Arena init failed");
+    };
+    ArenaStream stream;
+    if (!ArenaStream_init(&stream, &arena)) {
+        assert(false && "Stream init failed");
+    };
+    char expected[20000];
+    for (size_t i = 0; i < sizeof(expected); ++i) expected[i] = (char)('a' + i % 26);
+    for (size_t i = 0; i < sizeof(expected); i += 100)
+        assert(ArenaStream_append(&stream, expected + i, 100) && "Append failed");
+    size_t count;
+    const struct iovec* chunks = ArenaStream_iovec(&stream, &count);
+    assert(stream.length == sizeof(expected) && chunks != NULL && "Stream should hold the bytes");
+    // Guard bytes between allocations keep runs apart in the debug and sanitizer builds
+    assert((ARENA_ALLOC_OVERHEAD != 0 || count <= arena.pages + 1) && "Runs that continue a chunk should extend it");
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        assert(memcmp(chunks[i].iov_base, expected + offset, chunks[i].iov_len) == 0 && "Chunks should hold the bytes in order");
+        offset += chunks[i].iov_len;
+    }
+    assert(offset == sizeof(expected) && "Chunks should cover the stream");
+
+    printf("Writing the stream to a pipe\n");
+    int fds[2];
+    assert(pipe(fds) == 0 && "Pipe failed");
+    const char* header = "header:";
+    ArenaStream_reset(&stream);
+    assert(ArenaStream_append_ref(&stream, header, strlen(header)) && "Append failed");
+    assert(ArenaStream_append(&stream, expected, 1000) && "Append failed");
+    assert(ArenaStream_write(&stream, fds[1]) == 1007 && stream.length == 0 && "Write should consume the stream");
+
+    printf("Receiving into the free tail of the arena\n");
+    while (stream.length < 1007)
+        assert(ArenaStream_read(&stream, fds[0], 4096) > 0 && "Read should append the bytes");
+    assert(stream.length == 1007 && arena.current->arena.next_offset < arena.current->arena.capacity && "Read should hand back the unused tail");
+    char received[1007];
+    offset = 0;
+    chunks = ArenaStream_iovec(&stream, &count);
+    for (size_t i = 0; i < count; ++i) {
+        memcpy(received + offset, chunks[i].iov_base, chunks[i].iov_len);
+        offset += chunks[i].iov_len;
+    }
+    assert(memcmp(received, "header:", 7) == 0 && memcmp(received + 7, expected, 1000) == 0 && "Read should receive the bytes");
+    ArenaStream_consume(&stream, 7);
+    chunks = ArenaStream_iovec(&stream, &count);
+    assert(stream.length == 1000 && memcmp(chunks[0].iov_base, expected, chunks[0].iov_len < 1000 ? chunks[0].iov_len : 1000) == 0 && "Consume should drop the front");
+    close(fds[1]);
+    assert(ArenaStream_read(&stream, fds[0], 4096) == 0 && stream.length == 1000 && "Read should report end of file");
+    close(fds[0]);
+    GrowableArena_free(&arena);
+}
+
+typedef struct snapshot_node_t {
+    ArenaRelPtr next;
+    int value;
+} SnapshotNode;
+
+void test_snapshot(void) {
+    printf("Testing arena snapshots\n");
+    char path[] = "/tmp/arena-snapshot-XXXXXX";
+    const int fd = mkstemp(path);
+    assert(fd >= 0 && "Temporary file failed");
+    close(fd);
+
+    Arena arena = {0};
+    if (!Arena_init(&arena, 65536)) {
+        assert(false && "Arena init failed");
+    };
+    SnapshotNode* head = NULL;
+    for (int i = 0; i < 100; ++i) {
+        SnapshotNode* node = Arena_alloc_aligned(&arena, sizeof(SnapshotNode), alignof(SnapshotNode));
+        node->value = i;
+        ArenaRelPtr_set(&node->next, head);
+        head = node;
+    }
+    char* aligned = Arena_alloc_aligned(&arena, 100, 256);
+    strcpy(aligned, "aligned");
+    assert(Arena_at(&arena, Arena_offset(&arena, head)) == head && Arena_offset(&arena, NULL) == ARENA_NULL_OFFSET && "Offsets should round trip");
+    const size_t aligned_offset = Arena_offset(&arena, aligned);
+    assert(Arena_save(&arena, path, head) && "Save failed");
+    int outside;
+    assert(!Arena_save(&arena, path, &outside) && "A root outside the arena should fail");
+    assert(Arena_save(&arena, path, head) && "Save failed");
+    Arena_free(&arena);
+
+    printf("Loading the snapshot, relative pointers should resolve\n");
+    ArenaSnapshot snapshot;
+    assert(ArenaSnapshot_load(&snapshot, path) && "Load failed");
+    int expected = 99;
+    for (const SnapshotNode* node = ArenaSnapshot_root(&snapshot); node != NULL; node = ArenaRelPtr_get(&node->next))
+        assert(node->value == expected-- && "Nodes should survive the snapshot");
+    assert(expected == -1 && "All nodes should be reachable");
+    const char* loaded = ArenaSnapshot_at(&snapshot, aligned_offset);
+    assert((uintptr_t)loaded % 256 == 0 && strcmp(loaded, "aligned") == 0 && "Aligned data should stay aligned");
+    assert(ArenaSnapshot_at(&snapshot, snapshot.size) == NULL && "Offsets past the data should fail");
+    ArenaSnapshot_free(&snapshot);
+
+    VirtualArena virtual_arena = {0};
+    if (!VirtualArena_init(&virtual_arena, 1 << 20, 0)) {
+        assert(false && "Arena init failed");
+    };
+    int* numbers = VirtualArena_alloc(&virtual_arena, 1000 * sizeof(int));
+    for (int i = 0; i < 1000; ++i) numbers[i] = i * i;
+    assert(VirtualArena_save(&virtual_arena, path, numbers) && "Save failed");
+    VirtualArena_free(&virtual_arena);
+    assert(ArenaSnapshot_load(&snapshot, path) && "Load failed");
+    const int* loaded_numbers = ArenaSnapshot_root(&snapshot);
+    assert(loaded_numbers[999] == 999 * 999 && "Virtual arena data should survive the snapshot");
+    ArenaSnapshot_free(&snapshot);
+
+    printf("Loading a snapshot with a corrupted residue, this should fail\n");
+    {
+        char file[ARENA_SNAPSHOT_HEADER_SIZE + 10] = {0};
+        ArenaSnapshotHeader header = {
+            .version = ARENA_SNAPSHOT_VERSION,
+            .byte_order = 0x01020304,
+            .pointer_size = sizeof(void*),
+            .size = 1024 * 1024,
+            .residue = 100,
+            .root = UINT64_MAX,
+        };
+        memcpy(header.magic, "ARENASNP", 8);
+        memcpy(file, &header, sizeof(header));
+        FILE* out = fopen(path, "wb");
+        assert(out != NULL && fwrite(file, 1, 4096, out) == 4096 && "Writing the file failed");
+        fclose(out);
+        assert(!ArenaSnapshot_load(&snapshot, path) && "A snapshot larger than its file should fail");
+        header.size = 0;
+        header.residue = ARENA_MAX_ALIGNMENT - 1;
+        out = fopen(path, "wb");
+        memcpy(file, &header, sizeof(header));
+        assert(out != NULL && fwrite(file, 1, sizeof(file), out) == sizeof(file) && "Writing the file failed");
+        fclose(out);
+        assert(!ArenaSnapshot_load(&snapshot, path) && "A residue beyond the file should fail");
+    }
+
+    printf("Loading a truncated snapshot, this should fail\n");
+    assert(truncate(path, ARENA_SNAPSHOT_HEADER_SIZE + 100) == 0 && "Truncate failed");
+    assert(!ArenaSnapshot_load(&snapshot, path) && "A truncated snapshot should fail");
+    unlink(path);
+    assert(!ArenaSnapshot_load(&snapshot, path) && "A missing snapshot should fail");
+}
+
+typedef struct counting_allocator_t {
+    size_t allocs;
+    size_t frees;
+    size_t bytes;
+} CountingAllocator;
+
+static void* counting_alloc(void* context, size_t size) {
+    CountingAllocator* counter = context;
+    counter->allocs++;
+    counter->bytes += size;
+    return malloc(size);
+}
+
+static void counting_free(void* context, void* ptr, size_t size) {
+    CountingAllocator* counter = context;
+    counter->frees++;
+    counter->bytes -= size;
+    free(ptr);
+}
+
+static void* moving_realloc(void* context, void* ptr, size_t old_size, size_t new_size) {
+    void* moved = counting_alloc(context, new_size);
+    if (moved == NULL) return NULL;
+    memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+    counting_free(context, ptr, old_size);
+    return moved;
+}
+
+void test_retention_growth(void) {
+    printf("Testing page retention with growing pages\n");
+    CountingAllocator counter = {0};
+    const ArenaAllocator allocator = { .alloc = counting_alloc, .free = counting_free, .context = &counter };
+    const GrowableArenaOptions options = {
+        .page_size = 4096,
+        .growth = ARENA_GROWTH_DOUBLE,
+        .retain_pages = 2,
+        .allocator = &allocator,
+    };
+    GrowableArena garena = {0};
+    if (!GrowableArena_init_with_options(&garena, &options)) {
+        assert(false && "Arena init failed");
+    };
+
+    printf("Running reset cycles, page size and memory should stay the same\n");
+    size_t page_size = 0, bytes = 0;
+    for (int cycle = 0; cycle < 8; ++cycle) {
+        for (int i = 0; i < 6; ++i) assert(GrowableArena_alloc(&garena, 4000) != NULL && "GArena alloc should have not failed");
+        assert(garena.pages == 3 && "Arena should have three pages");
+        if (cycle == 1) {
+            bytes = counter.bytes;
+        } else if (cycle > 1) {
+            assert(counter.bytes == bytes && "Memory should not grow across cycles");
+        }
+        GrowableArena_reset(&garena);
+        assert(garena.pages == 2 && "Arena should keep two pages");
+        if (cycle == 0) page_size = garena.page_size;
+        assert(garena.page_size == page_size && "Page size should not grow across cycles");
+    }
+    assert(page_size == 16384 && "The next page should follow the last one kept");
+    GrowableArena_free(&garena);
+    assert(counter.bytes == 0 && "All memory should be released");
+}
+
+void test_backing_allocator(void) {
+    printf("Testing backing allocators\n");
+    CountingAllocator counter = {0};
+    const ArenaAllocator counting = { .alloc = counting_alloc, .free = counting_free, .context = &counter };
+    Arena arena = {0};
+    if (!Arena_init_with_allocator(&arena, 1024, &counting)) {
+        assert(false && "Arena init failed");
+    };
+    assert(counter.allocs == 1 && counter.bytes == 1024 && "Arena should draw its block from the allocator");
+    assert(Arena_alloc(&arena, 100) != NULL && "Alloc failed");
+    Arena_free(&arena);
+    assert(counter.frees == 1 && counter.bytes == 0 && "Arena should release its block to the allocator");
+
+    printf("Stacking arenas, the child should draw from the parent\n");
+    GrowableArena parent = {0};
+    if (!GrowableArena_init(&parent, 65536)) {
+        assert(false && "Arena init failed");
+    };
+    const ArenaAllocator from_parent = GrowableArena_allocator(&parent);
+    const size_t remaining = GrowableArena_remaining(&parent);
+    Arena child = {0};
+    if (!Arena_init_with_allocator(&child, 4096, &from_parent)) {
+        assert(false && "Arena init failed");
+    };
+    assert(parent.current->arena.next_offset >= 4096 && "Child block should come from the parent");
+    Arena_free(&child);
+    assert((ARENA_ALLOC_OVERHEAD != 0 || GrowableArena_remaining(&parent) == remaining) && "The most recent block should go back to the parent");
+
+    GrowableArenaOptions options = { .page_size = 1024, .allocator = &from_parent };
+    GrowableArena nested = {0};
+    if (!GrowableArena_init_with_options(&nested, &options)) {
+        assert(false && "Arena init failed");
+    };
+    char* block = GrowableArena_alloc(&nested, 2000);
+    assert(block != NULL && nested.large_blocks == 1 && "Large block failed");
+    memset(block, 'x', 2000);
+    block = GrowableArena_realloc(&nested, block, 2000, 8000);
+    assert(block != NULL && block[1999] == 'x' && "Large blocks should resize through the parent");
+    for (int i = 0; i < 20; ++i)
+        assert(GrowableArena_alloc(&nested, 500) != NULL && "Alloc failed");
+    assert(nested.pages > 1 && "Child pages should come from the parent");
+    GrowableArena_free(&nested);
+    GrowableArena_free(&parent);
+
+    printf("Moving a large block from before a mark, rewind should keep it\n");
+    const ArenaAllocator moving = {
+        .alloc = counting_alloc, .free = counting_free, .realloc = moving_realloc, .context = &counter,
+    };
+    options = (GrowableArenaOptions){ .page_size = 1024, .allocator = &moving };
+    if (!GrowableArena_init_with_options(&nested, &options)) {
+        assert(false && "Arena init failed");
+    };
+    char* kept = GrowableArena_alloc(&nested, 2000);
+    assert(kept != NULL && "Large block failed");
+    memset(kept, 'x', 2000);
+    const GrowableArenaMark mark = GrowableArena_mark(&nested);
+    char* moved = GrowableArena_realloc(&nested, kept, 2000, 8000);
+    assert(moved != NULL && moved[1999] == 'x' && "Large block realloc failed");
+    assert((ARENA_ALLOC_OVERHEAD != 0 || moved != kept) && "The backing allocator should have moved the block");
+    assert(GrowableArena_alloc(&nested, 3000) != NULL && "Large block failed");
+    assert((ARENA_ALLOC_OVERHEAD != 0 || nested.large_blocks == 2) && "Arena should hold two large blocks");
+    GrowableArena_rewind(&nested, mark);
+    assert((ARENA_ALLOC_OVERHEAD != 0 || nested.large_blocks == 1) && "Rewind should keep the moved block");
+    // Without the realloc path the copy came after the mark, the original block is the one kept
+    const char* survivor = ARENA_ALLOC_OVERHEAD == 0 ? moved : kept;
+    assert(survivor[0] == 'x' && survivor[1999] == 'x' && "The block from before the mark should keep its contents");
+    GrowableArena_free(&nested);
+    assert(counter.bytes == 0 && "All memory should be released");
+}
+
+void test_child_arena(void) {
+    printf("Testing child arenas\n");
+    GrowableArena parent = {0};
+    if (!GrowableArena_init(&parent, 8192)) {
+        assert(false && "Arena init failed");
+    };
+    assert(GrowableArena_alloc(&parent, 100) != NULL && "Alloc failed");
+    const size_t remaining = GrowableArena_remaining(&parent);
+    Arena child = {0};
+    if (!Arena_init_child(&child, &parent, 1024)) {
+        assert(false && "Child init failed");
+    };
+    assert(GrowableArena_remaining(&parent) < remaining - 1024 && "Child block should come from the parent");
+    char* data = Arena_alloc(&child, 500);
+    assert(data != NULL && Arena_alloc(&child, 1024) == NULL && "Child should be bounded by its block");
+    memset(data, 'x', 500);
+    Arena_free(&child);
+    assert(GrowableArena_remaining(&parent) == remaining && "Freeing a child on top should rewind the parent");
+
+    printf("Freeing a child below the top, this should keep its block\n");
+    if (!Arena_init_child(&child, &parent, 1024)) {
+        assert(false && "Child init failed");
+    };
+    assert(GrowableArena_alloc(&parent, 100) != NULL && "Alloc failed");
+    const size_t after = GrowableArena_remaining(&parent);
+    Arena_free(&child);
+    assert(GrowableArena_remaining(&parent) == after && "A child below the top should stay until the parent is reset");
+    GrowableArena_reset(&parent);
+
+    printf("Nesting request, stage and temporary arenas\n");
+    const ArenaAllocator from_request = GrowableArena_allocator(&parent);
+    const GrowableArenaOptions options = { .page_size = 2048, .allocator = &from_request };
+    GrowableArena stage = {0};
+    if (!GrowableArena_init_with_options(&stage, &options)) {
+        assert(false && "Arena init failed");
+    };
+    const size_t stage_remaining = GrowableArena_remaining(&stage);
+    Arena tmp = {0};
+    if (!Arena_init_child(&tmp, &stage, 16384)) {
+        assert(false && "Child init failed");
+    };
+    assert(stage.large_blocks == 1 && Arena_alloc(&tmp, 10000) != NULL && "A big child should get a large block");
+    Arena_free(&tmp);
+    assert(stage.large_blocks == 0 && GrowableArena_remaining(&stage) == stage_remaining && "Freeing the child should release the large block");
+    GrowableArena_free(&stage);
+    GrowableArena_free(&parent);
+}
+
+static bool is_resident(const void* ptr, const size_t size) {
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    const uintptr_t start = (uintptr_t)ptr & ~(uintptr_t)(page_size - 1);
+    const size_t pages = ((uintptr_t)ptr + size - start + page_size - 1) / page_size;
+    unsigned char resident[256];
+    assert(pages <= sizeof(resident) && mincore((void*)start, pages * page_size, resident) == 0 && "mincore failed");
+    for (size_t i = 0; i < pages; ++i)
+        if (!(resident[i] & 1)) return false;
+    return true;
+}
+
+static bool spare_ready(PagePrefetcher* prefetcher) {
+    for (int i = 0; i < 1000; ++i) {
+        pthread_mutex_lock(&prefetcher->lock);
+        const bool ready = prefetcher->spare != NULL;
+        pthread_mutex_unlock(&prefetcher->lock);
+        if (ready) return true;
+        usleep(1000);
+    }
+    return false;
+}
+
+void test_prefault(void) {
+    printf("Testing prefaulted arenas\n");
+    const ArenaAllocator prefault = ArenaAllocator_prefault(ARENA_PREFAULT);
+    Arena arena = {0};
+    if (!Arena_init_with_allocator(&arena, 256 * 1024, &prefault)) {
+        assert(false && "Arena init failed");
+    };
+    assert(is_resident(arena.data, arena.capacity) && "Arena memory should be faulted in");
+    Arena_free(&arena);
+
+    const ArenaAllocator locked = ArenaAllocator_prefault(ARENA_PREFAULT | ARENA_LOCK);
+    if (Arena_init_with_allocator(&arena, 64 * 1024, &locked)) {
+        assert(is_resident(arena.data, arena.capacity) && "Locked memory should be resident");
+        Arena_free(&arena);
+    } else {
+        printf("Locking memory is not permitted, skipping\n");
+    }
+
+    GrowableArenaOptions options = { .page_size = 8192, .allocator = &prefault };
+    GrowableArena growable = {0};
+    if (!GrowableArena_init_with_options(&growable, &options)) {
+        assert(false && "Arena init failed");
+    };
+    for (int i = 0; i < 10; ++i) GrowableArena_alloc(&growable, 4000);
+    assert(growable.pages > 1 && is_resident(growable.current->arena.data, growable.current->arena.capacity) && "New pages should be faulted in");
+    GrowableArena_free(&growable);
+
+    VirtualArena virtual_arena = {0};
+    if (!VirtualArena_init(&virtual_arena, 1 << 20, VIRTUAL_ARENA_PREFAULT)) {
+        assert(false && "Arena init failed");
+    };
+    assert(VirtualArena_alloc(&virtual_arena, 1000) != NULL && is_resident(virtual_arena.data, virtual_arena.committed) && "Committed memory should be faulted in");
+    VirtualArena_free(&virtual_arena);
+
+    printf("Prefetching pages on a background thread\n");
+    PagePrefetcher prefetcher;
+    if (!PagePrefetcher_init(&prefetcher, 4096, &prefault)) {
+        assert(false && "Prefetcher init failed");
+    };
+    assert(spare_ready(&prefetcher) && "The worker should prepare a page");
+    if (!PagePrefetcher_init_arena(&prefetcher, &growable)) {
+        assert(false && "Arena init failed");
+    };
+    for (int round = 0; round < 5; ++round) {
+        assert(spare_ready(&prefetcher) && "The worker should prepare the next page");
+        assert(GrowableArena_alloc(&growable, 3000) != NULL && "Alloc failed");
+    }
+    assert(growable.pages == 5 && prefetcher.hits == 5 && prefetcher.misses == 0 && "Pages should come from the worker");
+    assert(GrowableArena_alloc(&growable, 100000) != NULL && "Large blocks should bypass the prefetcher");
+    GrowableArena_free(&growable);
+    PagePrefetcher_free(&prefetcher);
+}
+
+#ifdef ARENA_TRACE
+void test_trace(void) {
+    printf("Testing allocation tracing\n");
+    ArenaTrace_reset();
+    GrowableArena arena = {0};
+    if (!GrowableArena_init(&arena, 4096)) {
+        assert(false && "Arena init failed");
+    };
+    for (int i = 0; i < 10; ++i) GrowableArena_alloc(&arena, 100);
+    const unsigned hot_line = __LINE__ - 1;
+    GrowableArena_alloc_aligned(&arena, 64, 64);
+    ArenaTraceEvent events[16];
+    const size_t count = ArenaTrace_recent(events, 16);
+    assert(count == 11 && events[0].size == 64 && events[1].size == 100 && events[0].arena == &arena && "Recent events should be recorded newest first");
+    assert(events[1].site->line == hot_line && atomic_load(&events[1].site->count) == 10 && atomic_load(&events[1].site->bytes) == 1000 && "Callsite should count its calls");
+    assert(events[0].time >= events[1].time && "Events should be timestamped");
+
+    FILE* out = tmpfile();
+    ArenaTrace_dump(out);
+    rewind(out);
+    char line[256], expected[64];
+    snprintf(expected, sizeof(expected), "tests.c:%u GrowableArena_alloc", hot_line);
+    assert(fgets(line, sizeof(line), out) != NULL && fgets(line, sizeof(line), out) != NULL && "Dump failed");
+    assert(strstr(line, expected) != NULL && strstr(line, "1000") != NULL && "The busiest callsite should come first");
+    fclose(out);
+    GrowableArena_free(&arena);
+}
+#endif
+
+#ifdef ARENA_STATS
+void test_stats(void) {
+    printf("Testing arena statistics\n");
+    Arena arena = {0};
+    if (!Arena_init(&arena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    Arena_alloc(&arena, 100);
+    Arena_alloc_aligned(&arena, 8, 64);
+    ArenaStats stats = Arena_stats(&arena);
+    assert(stats.requested == 108 && stats.allocations == 2 && "Arena should count the requests");
+    assert(stats.used == arena.next_offset && stats.committed == 1024 && "Arena should report its fill level");
+    assert(stats.fragmentation > 0.0 && "Alignment padding should count as fragmentation");
+
+    const ArenaMark mark = Arena_mark(&arena);
+    Arena_alloc(&arena, 200);
+    Arena_rewind(&arena, mark);
+    stats = Arena_stats(&arena);
+    assert(stats.requested == 108 && stats.peak == stats.used + 200 && "Rewind should keep the peak");
+    Arena_reset(&arena);
+    stats = Arena_stats(&arena);
+    assert(stats.requested == 0 && stats.used == 0 && stats.resets == 1 && "Reset should clear the counters");
+    assert(stats.peak > 300 && "Reset should keep the peak");
+    Arena_free(&arena);
+
+    printf("Testing growable arena statistics\n");
+    GrowableArena garena = {0};
+    if (!GrowableArena_init(&garena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    GrowableArena_alloc(&garena, 600);
+    GrowableArena_alloc(&garena, 600);
+    stats = GrowableArena_stats(&garena);
+    assert(stats.pages == 2 && stats.requested == 1200 && stats.allocations == 2 && "GArena should count the requests");
+    assert(stats.used == 1024 + 600 && "The tail of the first page should count as used");
+    assert(stats.committed == 2 * (ARENA_PAGE_HEADER_SIZE + 1024) && "GArena should count the pages");
+
+    const GrowableArenaMark gmark = GrowableArena_mark(&garena);
+    GrowableArena_alloc(&garena, 5000);
+    stats = GrowableArena_stats(&garena);
+    assert(stats.large_blocks == 1 && stats.requested == 6200 && "GArena should count large blocks");
+    assert(stats.committed == 3 * ARENA_PAGE_HEADER_SIZE + 2048 + 5000 && "GArena should count large blocks");
+    GrowableArena_rewind(&garena, gmark);
+    stats = GrowableArena_stats(&garena);
+    assert(stats.requested == 1200 && stats.large_blocks == 0 && "Rewind should drop the large block");
+    assert(stats.committed == 2 * (ARENA_PAGE_HEADER_SIZE + 1024) && "Rewind should drop the large block");
+
+    GrowableArena_reset(&garena);
+    stats = GrowableArena_stats(&garena);
+    assert(stats.requested == 0 && stats.used == 0 && stats.resets == 1 && "Reset should clear the counters");
+    assert(stats.peak == 1024 + 600 + 5000 && "Reset should keep the peak");
+    GrowableArena_free(&garena);
+}
+#endif
+
+#ifdef ARENA_ASAN
+void test_poisoning(void) {
+    printf("Testing AddressSanitizer poisoning\n");
+    Arena arena = {0};
+    if (!Arena_init(&arena, 1024)) {
+        assert(false && "Arena init failed");
+    };
+    assert(__asan_address_is_poisoned((char*)arena.data + 512) && "Fresh arena should be poisoned");
+
+    printf("Allocating, this should unpoison the allocation only\n");
+    char* data = Arena_alloc_aligned(&arena, 32, 16);
+    assert(!__asan_address_is_poisoned(data) && !__asan_address_is_poisoned(data + 31) && "Allocation should be unpoisoned");
+    char* data2 = Arena_alloc_aligned(&arena, 32, 16);
+    if (ARENA_GUARD_SIZE > 0) {
+        assert(__asan_address_is_poisoned(data + 32) && "Red zone should follow the allocation");
+        assert(data2 >= data + 32 + ARENA_GUARD_SIZE && "Allocations should be apart");
+    }
+
+    printf("Shrinking in place, this should poison the tail\n");
+    assert(Arena_realloc(&arena, data2, 32, 16) == data2 && "Last allocation should shrink in place");
+    assert(__asan_address_is_poisoned(data2 + 16) && "Tail should be poisoned");
+
+    printf("Rewinding and resetting, this should poison the released memory\n");
+    const ArenaMark mark = Arena_mark(&arena);
+    char* data3 = Arena_alloc_aligned(&arena, 64, 16);
+    Arena_rewind(&arena, mark);
+    assert(__asan_address_is_poisoned(data3) && "Rewound memory should be poisoned");
+    assert(!__asan_address_is_poisoned(data) && "Memory before the mark should stay usable");
+    Arena_reset(&arena);
+    assert(__asan_address_is_poisoned(data) && "Reset memory should be poisoned");
+    Arena_free(&arena);
+
+    GrowableArena garena = {0};
+    if (!GrowableArena_init(&garena, 256)) {
+        assert(false && "Arena init failed");
+    };
+    char* gdata = GrowableArena_alloc_aligned(&garena, 200, 16);
+    char* glarge = GrowableArena_alloc_aligned(&garena, 1000, 16);
+    assert(!__asan_address_is_poisoned(gdata) && !__asan_address_is_poisoned(glarge + 999) && "GArena allocations should be unpoisoned");
+    GrowableArena_reset(&garena);
+    assert(__asan_address_is_poisoned(gdata) && "Reset pages should be poisoned");
+    GrowableArena_free(&garena);
+
+    VirtualArena varena = {0};
+    if (!VirtualArena_init(&varena, 1 << 20, 0)) {
+        assert(false && "Virtual arena init failed");
+    };
+    char* vdata = VirtualArena_alloc_aligned(&varena, 64, 16);
+    assert(!__asan_address_is_poisoned(vdata) && "Virtual allocation should be unpoisoned");
+    VirtualArena_reset(&varena);
+    assert(__asan_address_is_poisoned(vdata) && "Reset virtual memory should be poisoned");
+    VirtualArena_free(&varena);
 }
+#endif
 
 int main(void) {
+#ifdef ARENA_ASAN
+    test_poisoning();
+#endif
+#if ARENA_ALLOC_OVERHEAD != 0
+    // The other tests check exact fill levels, which include the allocation overhead here
+#ifdef ARENA_DEBUG
+    test_debug_checks();
+#endif
+#else
     test_arena();
+    test_aligned_arena();
+    test_growth_policy();
+    test_page_retention();
+    test_mark_rewind();
+    test_realloc();
+    test_bulk_alloc();
+    test_virtual_arena();
+    test_page_pool();
+#ifdef ARENA_STATS
+    test_stats();
+#endif
+#endif
+    test_atomic_arena();
+    test_arena_str();
+    test_containers();
+    test_file_loading();
+    test_stream();
+    test_snapshot();
+    test_backing_allocator();
+    test_retention_growth();
+    test_child_arena();
+    test_prefault();
+#ifdef ARENA_TRACE
+    test_trace();
+#endif
+    test_pool();
+    test_slab();
 
     return 0;
 }